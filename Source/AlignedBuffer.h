@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * AlignedBuffer class for scratch memory that is reused across frames.
+ * The storage start is aligned to a cache line so SIMD loads never straddle one,
+ * and the buffer only ever grows, so steady-state use performs no allocation.
+ * @tparam T - The element type (e.g., float).
+ */
+template <typename T, size_t Alignment = 64>
+class AlignedBuffer
+{
+public:
+    AlignedBuffer() = default;
+
+    explicit AlignedBuffer(int numElements)
+    {
+        ensureSize(numElements);
+    }
+
+    // Grow the buffer to hold at least numElements. Existing contents are not preserved on growth.
+    void ensureSize(int numElements)
+    {
+        assert(numElements >= 0 && "Size must not be negative");
+
+        if (numElements <= capacity)
+            return;
+
+        storage.allocate(static_cast<size_t>(numElements) * sizeof(T) + Alignment, true);
+
+        auto address = reinterpret_cast<uintptr_t>(storage.get());
+        aligned = reinterpret_cast<T*>((address + Alignment - 1) & ~static_cast<uintptr_t>(Alignment - 1));
+        capacity = numElements;
+    }
+
+    void clear(int numElements)
+    {
+        assert(numElements <= capacity);
+        std::memset(aligned, 0, static_cast<size_t>(numElements) * sizeof(T));
+    }
+
+    T* get() noexcept { return aligned; }
+    const T* get() const noexcept { return aligned; }
+    int getCapacity() const noexcept { return capacity; }
+
+    T& operator[](int index) noexcept { return aligned[index]; }
+    const T& operator[](int index) const noexcept { return aligned[index]; }
+
+private:
+    juce::HeapBlock<char> storage; ///< Raw allocation, over-sized by the alignment.
+    T* aligned = nullptr;          ///< First aligned element inside storage.
+    int capacity = 0;              ///< Number of elements available from aligned.
+
+    JUCE_DECLARE_NON_COPYABLE(AlignedBuffer)
+};
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include "RealtimeChecks.h"
+#define ANALYSIS_RATE 30 //in hertz, for instances whose editor is showing
+#define BACKGROUND_ANALYSIS_RATE 5 //in hertz, for everything else
+
+/**
+ * AnalysisScheduler: one pool of analysis threads shared by every plugin instance in the process.
+ * Hold it through a juce::SharedResourcePointer<AnalysisScheduler>; the pool starts with the
+ * first instance and stops with the last.
+ *
+ * Each registered client is homed on one worker. A worker runs the most urgent due client of its
+ * own, foreground (visible editor) clients before background ones; when none of its own is due it
+ * steals one from another worker and keeps it. Background clients run at BACKGROUND_ANALYSIS_RATE,
+ * and when the pool falls behind they are rescheduled from the current time rather than catching
+ * up, so their rate drops first while foreground clients stay as close to ANALYSIS_RATE as possible.
+ *
+ * A running analysis can split independent work (one spectrum per channel, say) with runInParallel():
+ * idle workers join in and the caller works through the items too, so it never waits for a worker
+ * that is busy elsewhere and calling it from a pool thread cannot deadlock.
+ */
+class AnalysisScheduler
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        // Runs on a pool thread; never called concurrently for the same client
+        virtual void runScheduledAnalysis() = 0;
+    };
+
+    class ParallelJob
+    {
+    public:
+        virtual ~ParallelJob() = default;
+
+        // Runs on the caller of runInParallel() or on a pool thread; items may run concurrently
+        virtual void runItem(int index) = 0;
+    };
+
+    AnalysisScheduler()
+    {
+        const int numWorkers = juce::jlimit(1, 4, juce::SystemStats::getNumCpus() / 2);
+
+        for (int i = 0; i < numWorkers; ++i)
+            workers.add(new Worker(*this, i));
+
+        for (auto* worker : workers)
+            worker->startThread(juce::Thread::Priority::low);
+    }
+
+    ~AnalysisScheduler()
+    {
+        jassert(entries.empty() && "Clients must remove themselves before the scheduler goes away");
+
+        for (auto* worker : workers)
+            worker->signalThreadShouldExit();
+
+        for (auto* worker : workers)
+            worker->stopThread(1000);
+    }
+
+    void addClient(Client& client, bool isForeground)
+    {
+        {
+            const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+            jassert(findEntry(client) == nullptr);
+
+            auto entry = std::make_unique<Entry>();
+            entry->client = &client;
+            entry->homeWorker = nextHomeWorker++ % workers.size();
+            entry->isForeground = isForeground;
+            entry->dueTime = juce::Time::getMillisecondCounterHiRes();
+            entries.push_back(std::move(entry));
+        }
+
+        wakeWorkers();
+    }
+
+    // Blocks until the client's analysis is not running anymore; it is never called again afterwards
+    void removeClient(Client& client)
+    {
+        for (;;)
+        {
+            {
+                const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+
+                for (auto it = entries.begin(); it != entries.end(); ++it)
+                {
+                    if ((*it)->client != &client)
+                        continue;
+
+                    if ((*it)->isRunning)
+                        break;
+
+                    entries.erase(it);
+                    return;
+                }
+
+                if (findEntry(client) == nullptr)
+                    return;
+            }
+
+            entryFinished.wait(5);
+        }
+    }
+
+    void setForeground(Client& client, bool isForeground)
+    {
+        {
+            const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+
+            if (Entry* entry = findEntry(client))
+            {
+                if (isForeground && ! entry->isForeground)
+                    entry->dueTime = juce::Time::getMillisecondCounterHiRes(); // Catch up right away
+
+                entry->isForeground = isForeground;
+            }
+        }
+
+        wakeWorkers();
+    }
+
+    int getNumWorkers() const { return workers.size(); }
+
+    // Runs job.runItem(i) for i in [0, numItems) on the calling thread and any idle workers, and
+    // returns once every item has finished
+    void runInParallel(ParallelJob& job, int numItems)
+    {
+        if (numItems <= 1)
+        {
+            if (numItems == 1)
+                job.runItem(0);
+
+            return;
+        }
+
+        Batch batch;
+        batch.job = &job;
+        batch.numItems = numItems;
+
+        {
+            const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+            batches.push_back(&batch);
+        }
+
+        wakeWorkers();
+        runBatchItems(batch);
+
+        // No new helper can join once the batch is gone from the list; wait for the ones inside it
+        {
+            const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+            batches.erase(std::find(batches.begin(), batches.end(), &batch));
+        }
+
+        while (batch.numHelpers.load(std::memory_order_acquire) > 0)
+            helperFinished.wait(1);
+    }
+
+private:
+    struct Entry
+    {
+        Client* client = nullptr;
+        int homeWorker = 0;       ///< Worker whose queue the client is in; changes when stolen.
+        double dueTime = 0.0;     ///< Millisecond counter at which the next analysis is due.
+        bool isForeground = false;
+        bool isRunning = false;
+    };
+
+    struct Batch
+    {
+        ParallelJob* job = nullptr;
+        int numItems = 0;
+        std::atomic<int> nextItem { 0 };
+        std::atomic<int> numHelpers { 0 }; ///< Workers currently inside runBatchItems() for this batch.
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(AnalysisScheduler& _scheduler, int _index)
+            : juce::Thread("Spectrum Analysis " + juce::String(_index + 1)), scheduler(_scheduler), index(_index)
+        {
+        }
+
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                double waitTime = maxWaitTime;
+
+                if (Batch* batch = scheduler.joinBatch())
+                {
+                    scheduler.runBatchItems(*batch);
+                    scheduler.leaveBatch(*batch);
+                    continue;
+                }
+
+                if (Entry* entry = scheduler.takeDueEntry(index, waitTime))
+                {
+                    entry->client->runScheduledAnalysis();
+                    scheduler.finishEntry(*entry);
+                    continue;
+                }
+
+                wait(juce::jlimit(1, (int)maxWaitTime, (int)waitTime));
+            }
+        }
+
+    private:
+        AnalysisScheduler& scheduler;
+        const int index;
+    };
+
+    static constexpr double maxWaitTime = 50.0; // ms; bounds how late a worker notices clients to steal
+
+    static double getInterval(const Entry& entry)
+    {
+        return 1000.0 / (entry.isForeground ? ANALYSIS_RATE : BACKGROUND_ANALYSIS_RATE);
+    }
+
+    static bool isMoreUrgent(const Entry& a, const Entry& b)
+    {
+        if (a.isForeground != b.isForeground)
+            return a.isForeground;
+
+        return a.dueTime < b.dueTime;
+    }
+
+    // Picks the client this worker should run now, its own first, otherwise stolen from another worker.
+    // If there is none, waitTime is lowered to the time until the next one falls due.
+    Entry* takeDueEntry(int workerIndex, double& waitTime)
+    {
+        const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+        const double now = juce::Time::getMillisecondCounterHiRes();
+
+        Entry* own = nullptr;
+        Entry* stolen = nullptr;
+
+        for (auto& entry : entries)
+        {
+            if (entry->isRunning)
+                continue;
+
+            if (entry->dueTime > now)
+            {
+                waitTime = juce::jmin(waitTime, entry->dueTime - now);
+                continue;
+            }
+
+            Entry*& best = entry->homeWorker == workerIndex ? own : stolen;
+            if (best == nullptr || isMoreUrgent(*entry, *best))
+                best = entry.get();
+        }
+
+        Entry* chosen = own != nullptr ? own : stolen;
+        if (chosen != nullptr)
+        {
+            chosen->homeWorker = workerIndex;
+            chosen->isRunning = true;
+        }
+
+        return chosen;
+    }
+
+    void finishEntry(Entry& entry)
+    {
+        {
+            const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+            const double now = juce::Time::getMillisecondCounterHiRes();
+            const double interval = getInterval(entry);
+
+            // Foreground clients keep their cadence; background ones give way when the pool is behind
+            entry.dueTime += interval;
+            if (entry.dueTime < now)
+                entry.dueTime = entry.isForeground ? now : now + interval;
+
+            entry.isRunning = false;
+        }
+
+        entryFinished.signal();
+    }
+
+    // Claims items of the batch until none are left
+    static void runBatchItems(Batch& batch)
+    {
+        for (int item = batch.nextItem++; item < batch.numItems; item = batch.nextItem++)
+            batch.job->runItem(item);
+    }
+
+    // A batch that still has unclaimed items, with this worker counted as its helper; null if none
+    Batch* joinBatch()
+    {
+        const RealtimeChecks::ScopedCheckedLock lock(entriesLock);
+
+        for (Batch* batch : batches)
+        {
+            if (batch->nextItem.load(std::memory_order_relaxed) < batch->numItems)
+            {
+                ++batch->numHelpers;
+                return batch;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void leaveBatch(Batch& batch)
+    {
+        --batch.numHelpers; // The batch may be gone as soon as this reaches zero
+        helperFinished.signal();
+    }
+
+    Entry* findEntry(Client& client)
+    {
+        for (auto& entry : entries)
+        {
+            if (entry->client == &client)
+                return entry.get();
+        }
+
+        return nullptr;
+    }
+
+    void wakeWorkers()
+    {
+        for (auto* worker : workers)
+            worker->notify();
+    }
+
+    juce::OwnedArray<Worker> workers;
+    juce::CriticalSection entriesLock;              ///< Guards entries; never held while a client runs.
+    std::vector<std::unique_ptr<Entry>> entries;
+    juce::WaitableEvent entryFinished;
+    std::vector<Batch*> batches;                    ///< Parallel work offered to idle workers; guarded by entriesLock.
+    juce::WaitableEvent helperFinished;
+    int nextHomeWorker = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisScheduler)
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include "AudioVisualizationProcessor.h"
+#include "TripleBuffer.h"
+#include "AnalysisScheduler.h"
+
+/**
+ * AnalysisWorker runs the display analysis of one plugin instance off the audio and message threads.
+ * It is a client of the process-wide AnalysisScheduler, which calls it from a shared thread pool at
+ * ANALYSIS_RATE while the instance's editor is showing and at BACKGROUND_ANALYSIS_RATE otherwise.
+ * Every pass pulls from the capture ring of an AudioVisualizationProcessor and publishes the result
+ * through a triple buffer, so neither the audio thread nor the message thread ever waits on the FFT.
+ * A pass with no new audio and no settings change publishes nothing, and neither does one fed only
+ * by silence once the display has settled on it. Per-channel spectra of one pass are spread over
+ * the pool's idle workers.
+ */
+class AnalysisWorker : private AnalysisScheduler::Client
+{
+public:
+    explicit AnalysisWorker(AudioVisualizationProcessor& _processor)
+        : processor(_processor)
+    {
+        processor.setParallelScheduler(scheduler.get());
+    }
+
+    ~AnalysisWorker() override
+    {
+        stop();
+    }
+
+    void start()
+    {
+        if (! isScheduled)
+        {
+            scheduler->addClient(*this, isForeground());
+            isScheduled = true;
+        }
+    }
+
+    // Returns once no analysis of this instance is running anymore
+    void stop()
+    {
+        if (isScheduled)
+        {
+            scheduler->removeClient(*this);
+            isScheduled = false;
+        }
+    }
+
+    // The pool is shared, so this no longer sets a thread priority: Priority::background keeps the
+    // instance at the background rate even while its editor is showing
+    void setAnalysisPriority(juce::Thread::Priority _priority)
+    {
+        priority = _priority;
+        updateScheduling();
+    }
+
+    // Called by the editor: visible instances are analysed first and at the full rate
+    void setEditorVisible(bool isVisible)
+    {
+        if (isVisible == editorVisible)
+            return;
+
+        editorVisible = isVisible;
+        updateScheduling();
+    }
+
+    // Called from the message thread; picked up on the next analysis pass
+    void setSettings(const AnalysisSettings& settings)
+    {
+        waveformSamples.store(settings.waveformSamples, std::memory_order_relaxed);
+        waveformColumns.store(settings.waveformColumns, std::memory_order_relaxed);
+        fallbackSpeed.store(settings.fallbackSpeed, std::memory_order_relaxed);
+        stftFrameOrder.store(settings.stftFrameOrder, std::memory_order_relaxed);
+        stftHopSize.store(settings.stftHopSize, std::memory_order_relaxed);
+        averaging.store(settings.averaging, std::memory_order_relaxed);
+        attackSeconds.store(settings.attackSeconds, std::memory_order_relaxed);
+        windowType.store(settings.windowType, std::memory_order_relaxed);
+        spectrumEngine.store(settings.spectrumEngine, std::memory_order_relaxed);
+        spectrumColumns.store(settings.spectrumColumns, std::memory_order_relaxed);
+        spectrumMinDecibels.store(settings.spectrumMinDecibels, std::memory_order_relaxed);
+        spectrumMaxDecibels.store(settings.spectrumMaxDecibels, std::memory_order_relaxed);
+        peakHoldMode.store(settings.peakHoldMode, std::memory_order_relaxed);
+        peakReleaseDecibelsPerSecond.store(settings.peakReleaseDecibelsPerSecond, std::memory_order_relaxed);
+        zoomCentreFrequency.store(settings.zoomCentreFrequency, std::memory_order_relaxed);
+        zoomSpan.store(settings.zoomSpan, std::memory_order_relaxed);
+        lowPassFrequency.store(settings.lowPassFrequency, std::memory_order_relaxed);
+        channel.store(settings.channel, std::memory_order_relaxed);
+        overlayChannels.store(settings.overlayChannels, std::memory_order_relaxed);
+        stereoMidSide.store(settings.stereoMidSide, std::memory_order_relaxed);
+        compareReference.store(settings.compareReference, std::memory_order_relaxed);
+    }
+
+    // The settings the next analysis pass will use
+    AnalysisSettings getSettings() const
+    {
+        AnalysisSettings settings;
+        settings.waveformSamples = waveformSamples.load(std::memory_order_relaxed);
+        settings.waveformColumns = waveformColumns.load(std::memory_order_relaxed);
+        settings.fallbackSpeed = fallbackSpeed.load(std::memory_order_relaxed);
+        settings.stftFrameOrder = stftFrameOrder.load(std::memory_order_relaxed);
+        settings.stftHopSize = stftHopSize.load(std::memory_order_relaxed);
+        settings.averaging = averaging.load(std::memory_order_relaxed);
+        settings.attackSeconds = attackSeconds.load(std::memory_order_relaxed);
+        settings.windowType = windowType.load(std::memory_order_relaxed);
+        settings.spectrumEngine = spectrumEngine.load(std::memory_order_relaxed);
+        settings.spectrumColumns = spectrumColumns.load(std::memory_order_relaxed);
+        settings.spectrumMinDecibels = spectrumMinDecibels.load(std::memory_order_relaxed);
+        settings.spectrumMaxDecibels = spectrumMaxDecibels.load(std::memory_order_relaxed);
+        settings.peakHoldMode = peakHoldMode.load(std::memory_order_relaxed);
+        settings.peakReleaseDecibelsPerSecond = peakReleaseDecibelsPerSecond.load(std::memory_order_relaxed);
+        settings.zoomCentreFrequency = zoomCentreFrequency.load(std::memory_order_relaxed);
+        settings.zoomSpan = zoomSpan.load(std::memory_order_relaxed);
+        settings.lowPassFrequency = lowPassFrequency.load(std::memory_order_relaxed);
+        settings.channel = channel.load(std::memory_order_relaxed);
+        settings.overlayChannels = overlayChannels.load(std::memory_order_relaxed);
+        settings.stereoMidSide = stereoMidSide.load(std::memory_order_relaxed);
+        settings.compareReference = compareReference.load(std::memory_order_relaxed);
+        return settings;
+    }
+
+    // Consumer side (single thread, normally the editor's timer): moves to the newest result.
+    // Returns false if nothing new was published since the last call.
+    bool updateLatestResult()
+    {
+        return results.update();
+    }
+
+    const AnalysisResult& getLatestResult() const
+    {
+        return results.getReadBuffer();
+    }
+
+private:
+    void runScheduledAnalysis() override
+    {
+        analyseIfChanged();
+    }
+
+    bool isForeground() const
+    {
+        return editorVisible && priority != juce::Thread::Priority::background;
+    }
+
+    void updateScheduling()
+    {
+        if (isScheduled)
+            scheduler->setForeground(*this, isForeground());
+    }
+
+    // Runs and publishes an analysis only if new audio arrived or the settings changed since the last one
+    void analyseIfChanged()
+    {
+        const AnalysisSettings settings = getSettings();
+        const uint64_t sequence = processor.getWriteSequence();
+
+        const bool waveformSettingsChanged = ! hasPublished || ! settings.hasSameWaveform(lastSettings);
+        const bool spectrumSettingsChanged = ! hasPublished || ! settings.hasSameSpectrum(lastSettings);
+        const bool hasNewAudio = sequence != lastSequence;
+
+        // Once silence fills the whole window and has reached the display, more of it changes nothing
+        const bool isSettledInSilence = lastResultWasSilent && processor.isInputSilent(settings);
+
+        if (! waveformSettingsChanged && ! spectrumSettingsChanged && (! hasNewAudio || isSettledInSilence))
+            return;
+
+        AnalysisResult& result = results.getWriteBuffer();
+        processor.analyse(settings, result);
+
+        if (hasNewAudio || waveformSettingsChanged)
+            ++waveformVersion;
+
+        if (hasNewAudio || spectrumSettingsChanged)
+            ++spectrumVersion;
+
+        result.waveformVersion = waveformVersion;
+        result.spectrumVersion = spectrumVersion;
+        results.publish();
+
+        lastSettings = settings;
+        lastSequence = sequence;
+        lastResultWasSilent = AudioVisualizationProcessor::isSilent(result);
+        hasPublished = true;
+    }
+
+    AudioVisualizationProcessor& processor;
+    TripleBuffer<AnalysisResult> results;
+    juce::SharedResourcePointer<AnalysisScheduler> scheduler; ///< Shared by all instances in the process.
+    juce::Thread::Priority priority = juce::Thread::Priority::low;
+    bool editorVisible = false;
+    bool isScheduled = false;
+
+    // Analysis thread only: what the last published result was made from
+    AnalysisSettings lastSettings;
+    uint64_t lastSequence = 0;
+    uint64_t waveformVersion = 0;
+    uint64_t spectrumVersion = 0;
+    bool lastResultWasSilent = false;
+    bool hasPublished = false;
+
+    std::atomic<int> waveformSamples { AnalysisSettings().waveformSamples };
+    std::atomic<int> waveformColumns { AnalysisSettings().waveformColumns };
+    std::atomic<double> fallbackSpeed { AnalysisSettings().fallbackSpeed };
+    std::atomic<int> stftFrameOrder { AnalysisSettings().stftFrameOrder };
+    std::atomic<int> stftHopSize { AnalysisSettings().stftHopSize };
+    std::atomic<SpectrumAveraging> averaging { AnalysisSettings().averaging };
+    std::atomic<float> attackSeconds { AnalysisSettings().attackSeconds };
+    std::atomic<WindowType> windowType { AnalysisSettings().windowType };
+    std::atomic<SpectrumEngine> spectrumEngine { AnalysisSettings().spectrumEngine };
+    std::atomic<int> spectrumColumns { AnalysisSettings().spectrumColumns };
+    std::atomic<float> spectrumMinDecibels { AnalysisSettings().spectrumMinDecibels };
+    std::atomic<float> spectrumMaxDecibels { AnalysisSettings().spectrumMaxDecibels };
+    std::atomic<int> peakHoldMode { AnalysisSettings().peakHoldMode };
+    std::atomic<float> peakReleaseDecibelsPerSecond { AnalysisSettings().peakReleaseDecibelsPerSecond };
+    std::atomic<float> zoomCentreFrequency { AnalysisSettings().zoomCentreFrequency };
+    std::atomic<float> zoomSpan { AnalysisSettings().zoomSpan };
+    std::atomic<float> lowPassFrequency { AnalysisSettings().lowPassFrequency };
+    std::atomic<int> channel { AnalysisSettings().channel };
+    std::atomic<bool> overlayChannels { AnalysisSettings().overlayChannels };
+    std::atomic<bool> stereoMidSide { AnalysisSettings().stereoMidSide };
+    std::atomic<bool> compareReference { AnalysisSettings().compareReference };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisWorker)
+};
@@ -1,192 +1,968 @@
-#pragma once
-
-#include <JuceHeader.h>
-#include <vector>
-#include <complex>
-#include <cassert>
-#include <cmath>
-#include "CircularBuffer.h"
-#define SPECTRUM_SCALING_FACTOR 5
-
-class AudioVisualizationProcessor
-{
-public:
-    explicit AudioVisualizationProcessor(int buffer_capacity, int channels)
-    {
-        buffer = new CircularBuffer(channels, buffer_capacity);
-        peakHoldDelay[0] = 0;
-        peakHoldDelay[1] = 1.0f;
-        peakHoldDelay[2] = 2.0f;
-        peakHoldDelay[3] = 5.0f;
-    }
-
-    ~AudioVisualizationProcessor()
-    {
-        delete buffer; // Ensure the buffer is properly deallocated
-    }
-
-    // Push audio data to the circular buffer
-    void pushAudioData(const float* source, int numSamples, int channel)
-    {
-        buffer->push(source, numSamples, channel);
-    }
-
-    juce::Path getVisualizationPath(int numSamples, int channel, int height, int width)
-    {
-        juce::Path path; // Use a local path variable
-
-        // Temporary buffer for reading data
-        std::vector<float> tempBuffer(numSamples, 0.0f);
-
-        buffer->read(tempBuffer, numSamples, channel); // Read the data into tempBuffer
-
-        float x = 0.0f; // Initialize horizontal position tracker
-
-        // Create the waveform path
-        for (int i = 0; i < numSamples; ++i)
-        {
-            const float y = (tempBuffer[i] + 1.0f) * 0.5f * static_cast<float>(height); // Normalize to fit height
-            if (i == 0)
-                path.startNewSubPath(x, y);
-            else
-                path.lineTo(x, y);
-
-            x += static_cast<float>(width) / numSamples; // Evenly space the waveform across the width
-        }
-
-        return path; // Return the local path
-    }
-
-    juce::Path AudioVisualizationProcessor::getSpectrumPath(int numSamples, int channel, int height, int width, int peakHoldMode, float lowPassFrequency)
-    {
-        juce::Path path; // Path to hold the visual representation
-
-        if (peakHoldMode == -1) {
-            return path;
-        }
-
-
-        // Ensure numSamples is a power of two
-        numSamples = getPowerOfTwo(numSamples);
-
-        // Temporary buffer for the audio data
-        std::vector<float> tempBuffer(numSamples, 0.0f);
-
-        // Read the audio data into the tempBuffer
-        buffer->read(tempBuffer, numSamples, channel);
-
-        // Create a buffer for FFT (real + imaginary parts)
-        std::vector<float> fftData(numSamples * 2, 0.0f); // FFT input: real and imaginary parts interleaved
-
-        // Copy the tempBuffer into the real part of fftData
-        for (int i = 0; i < numSamples; ++i)
-        {
-            fftData[i] = tempBuffer[i];
-        }
-
-        // Perform FFT (real -> complex transform)
-        juce::dsp::FFT fft(static_cast<int>(std::log2(numSamples))); // FFT size as a power of 2
-        fft.performFrequencyOnlyForwardTransform(fftData.data());
-
-        // Extract magnitudes from FFT data (use only the first half: positive frequencies)
-        int numBins = numSamples / 2;
-        std::vector<float> magnitudes(numBins, 0.0f);
-
-        for (int i = 0; i < numBins; ++i)
-        {
-            float real = fftData[i];            // Real part
-            float imaginary = fftData[numSamples + i]; // Imaginary part
-            magnitudes[i] = std::sqrt(real * real + imaginary * imaginary);
-        }
-
-        if (peakHoldMode != 0) {
-            float delay = peakHoldDelay[peakHoldMode];
-            peaks.resize(numBins, 0.0f);
-            timePassed.resize(numBins, 0.0f);
-
-            lifetime = 30 * delay; //number of functioncalls in delayTime
-
-
-            for (int i = 0; i < numBins;i++) {
-                if (timePassed[i] >= lifetime) {
-                    peaks[i] = magnitudes[i];
-                    timePassed[i] = 0;
-                }
-                else {
-                    peaks[i] = std::max(peaks[i], magnitudes[i]);
-                    timePassed[i]++;
-                }
-            }
-        }
-
-        // Start drawing the spectrum
-        float x;
-        for (int i = 0; i < numBins; ++i)
-        {
-            // Increment x position for each frequency bin
-            float x = width * std::log(i + 1) / std::log(numSamples);
-            float y;
-            if (peakHoldMode != 0) {
-                y = height - (peaks[i] / SPECTRUM_SCALING_FACTOR);
-            }
-            else {
-                y = height - (magnitudes[i] / SPECTRUM_SCALING_FACTOR);
-            }
-
-            // Map to visual space
-            if (i == 0)
-                path.startNewSubPath(x, y); // Start at the first point
-            else
-                path.lineTo(x, y); // Draw line to the next point
-
-        }
-
-        // Add a vertical line at the cutoff frequency
-        if (lowPassFrequency > 0.0f) {
-            // Calculate x position for the cutoff frequency
-            int cutoffBin = static_cast<int>((lowPassFrequency * numSamples) / 20000);
-            cutoffBin = std::clamp(cutoffBin, 0, numBins - 1); // Make sure the bin is within range
-
-            float cutoffX = width * std::log(cutoffBin + 1) / std::log(numSamples);
-
-            // Create a new subpath for the vertical line
-            path.startNewSubPath(cutoffX, 0);  // Start at the top of the window
-            path.lineTo(cutoffX, height); // End at the bottom of the window
-        }
-
-        return path; // Return the constructed path
-    }
-
-
-
-
-    void setSampleRate(int _sampleRate)
-    {
-        sampleRate = _sampleRate;
-    }
-
-private:
-    int getPowerOfTwo(int numSamples)
-    {
-        int powers[25] = { 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536, 131072, 262144, 524288, 1048576, 2097152, 4194304, 8388608, 16777216 };
-        for (int i = 0; i < 25; i++) {
-            if (powers[i] > numSamples) {
-                return powers[i - 1];
-            }
-        }
-        // If no larger than numSamples
-        return powers[24];
-    }
-
-    float peakHoldDelay[4];
-
-    int sampleRate = 0;
-    CircularBuffer* buffer;
-
-    int lifetime;
-
-    std::vector<float> peaks;
-    std::vector<float> timePassed;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioVisualizationProcessor)
-};
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <complex>
+#include <cassert>
+#include <cmath>
+#include <utility>
+#include <atomic>
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "StftAnalyzer.h"
+#include "ConstantQAnalyzer.h"
+#include "ZoomFFTAnalyzer.h"
+#include "StereoStftAnalyzer.h"
+#include "WaveformPyramid.h"
+#include "SpectrumBinMap.h"
+#include "SpectrumKernels.h"
+#include "FrameArena.h"
+#include "AnalysisScheduler.h"
+
+// How the spectrum is estimated
+enum class SpectrumEngine
+{
+    stft = 0,  // One FFT size for every frequency, averaged over the fall-back time
+    constantQ, // Octave by octave at decimated rates: small FFTs, finer bins towards the low end
+    zoom       // One narrow band mixed down and decimated: sub-hertz bins, linear axis
+};
+
+// What the display asks the analysis to compute
+struct AnalysisSettings
+{
+    int waveformSamples = 20000; // Number of most recent samples shown in the waveform
+    int waveformColumns = 800;   // Pixel width of the waveform view, one min/max column per pixel
+    double fallbackSpeed = 0.5;  // Length of the spectrum window in seconds; the release time constant with exponential averaging
+    int stftFrameOrder = 12;     // Each STFT frame is 2^stftFrameOrder samples
+    int stftHopSize = 1024;      // Samples between consecutive STFT frames
+    SpectrumAveraging averaging = SpectrumAveraging::linear; // How STFT frames are combined (FFT engine, single channels)
+    float attackSeconds = 0.0f;  // Rise time constant of exponential averaging; 0 follows rising levels at once
+    WindowType windowType = WindowType::hann;
+    SpectrumEngine spectrumEngine = SpectrumEngine::stft;
+    int spectrumColumns = 200;   // Pixel width of the spectrum view, one value per column
+    float spectrumMinDecibels = -100.0f; // Level drawn at the bottom of the spectrum view
+    float spectrumMaxDecibels = 0.0f;    // Level drawn at the top (0 dBFS = full-scale sine)
+    int peakHoldMode = 0;        // -1 = spectrum off, 0 = none, 1..3 = fast/medium/slow hold
+    float peakReleaseDecibelsPerSecond = 20.0f; // How fast held peaks fall once their hold time is over
+    float zoomCentreFrequency = 1000.0f; // Band shown by the zoom engine, in hertz
+    float zoomSpan = 200.0f;
+    float lowPassFrequency = 0.0f;
+    int channel = 0;             // Captured channel of the waveform, and the soloed spectrum
+    bool overlayChannels = false; // Spectrum of every captured channel instead of only the soloed one
+    bool stereoMidSide = false;  // Left, right, mid and side of channel and the next one (STFT only; overlayChannels wins)
+    bool compareReference = false; // Channel against the sidechain reference, and their difference (STFT only; wins over stereoMidSide)
+
+    // True if the waveform computed with other would come out the same for the same audio
+    bool hasSameWaveform(const AnalysisSettings& other) const
+    {
+        return waveformSamples == other.waveformSamples && waveformColumns == other.waveformColumns && channel == other.channel;
+    }
+
+    // True if the spectrum computed with other would come out the same for the same audio
+    bool hasSameSpectrum(const AnalysisSettings& other) const
+    {
+        return fallbackSpeed == other.fallbackSpeed && stftFrameOrder == other.stftFrameOrder && stftHopSize == other.stftHopSize
+            && averaging == other.averaging && attackSeconds == other.attackSeconds
+            && windowType == other.windowType && spectrumEngine == other.spectrumEngine && spectrumColumns == other.spectrumColumns
+            && spectrumMinDecibels == other.spectrumMinDecibels && spectrumMaxDecibels == other.spectrumMaxDecibels
+            && peakHoldMode == other.peakHoldMode && peakReleaseDecibelsPerSecond == other.peakReleaseDecibelsPerSecond
+            && zoomCentreFrequency == other.zoomCentreFrequency && zoomSpan == other.zoomSpan
+            && lowPassFrequency == other.lowPassFrequency && channel == other.channel
+            && overlayChannels == other.overlayChannels && stereoMidSide == other.stereoMidSide
+            && compareReference == other.compareReference;
+    }
+};
+
+// One frame of analysis output, produced off the message thread and turned into geometry by the editor
+struct AnalysisResult
+{
+    std::vector<float> waveformMin; // Per-column minimum of the most recent samples, oldest column first
+    std::vector<float> waveformMax; // Per-column maximum
+    std::vector<float> waveformRms; // Per-column RMS level
+
+    std::vector<float> spectrum;  // Level in dBFS per pixel column of the log-frequency display (peak-held if enabled),
+                                  // one row of spectrumColumns per analysed channel, back to back
+    int spectrumColumns = 0;
+    int numDrawnColumns = 0;      // Leading columns of each row that hold bins; the log axis runs on past the last bin
+    int numSpectrumChannels = 0;  // Rows in spectrum, 0 if the spectrum is off
+    int soloChannel = 0;          // Captured channel of the only row, or -1 if row i is captured channel i
+    bool isMidSide = false;       // Rows are left, right, mid and side of soloChannel and the channel after it
+    bool isReference = false;     // Rows are soloChannel, the sidechain reference, and soloChannel minus reference in dB
+    float spectrumMinDecibels = -100.0f;
+    float spectrumMaxDecibels = 0.0f;
+    int fftSize = 0;              // Transform size the frequency axis is laid out for, 0 if the spectrum is off
+    float zoomLowFrequency = 0.0f;  // With the zoom engine the columns run linearly from here...
+    float zoomHighFrequency = 0.0f; // ...to here; both 0 for the log axis
+    float lowPassFrequency = 0.0f;
+
+    // Bumped by the producer whenever that part changed, so consumers can compare with what they last drew
+    uint64_t waveformVersion = 0;
+    uint64_t spectrumVersion = 0;
+
+    const float* getSpectrumRow(int row) const { return spectrum.data() + (size_t)row * spectrumColumns; }
+};
+
+/**
+ * AudioVisualizationProcessor: the capture history of the plugin and the analysis that reads it.
+ *
+ * The history (a CircularBuffer plus one WaveformPyramid per channel) is sized by prepare() for the
+ * analysis window of the current settings at the current sample rate. When the settings later ask for
+ * a longer or a much shorter window, the analysis thread builds a resized history holding the recent
+ * audio and hands it over as pending; the audio thread adopts it on its next push by copying the few
+ * samples that arrived meanwhile and swapping one atomic pointer. The replaced history is retired and
+ * freed by the analysis thread on its next pass, so the audio thread never allocates or frees.
+ *
+ * Every captured channel keeps its own spectrum engines. With overlayChannels set, their spectra are
+ * computed in parallel on the AnalysisScheduler pool, if one was set, into one contiguous result block.
+ * With stereoMidSide set, a channel pair is analysed by one packed complex transform per frame instead,
+ * giving left, right, mid and side rows.
+ *
+ * An optional sidechain is captured into a reference ring of its own, kept in step with the main one.
+ * With compareReference set, a channel and its reference are packed into the same kind of transform,
+ * so both go through one plan and one window pass per frame.
+ */
+class AudioVisualizationProcessor
+{
+public:
+    // Without a history: nothing is captured or analysed until prepare()
+    AudioVisualizationProcessor()
+    {
+        peakHoldSeconds[0] = 0;
+        peakHoldSeconds[1] = 1.0f;
+        peakHoldSeconds[2] = 2.0f;
+        peakHoldSeconds[3] = 5.0f;
+    }
+
+    explicit AudioVisualizationProcessor(int buffer_capacity, int channels, int reference_channels = 0)
+        : AudioVisualizationProcessor()
+    {
+        history.store(new CaptureHistory(channels, reference_channels, buffer_capacity), std::memory_order_release);
+    }
+
+    ~AudioVisualizationProcessor()
+    {
+        delete history.load(std::memory_order_relaxed);
+        delete pendingHistory.load(std::memory_order_relaxed);
+        delete retiredHistory.load(std::memory_order_relaxed);
+    }
+
+    // Replaces the capture history with an empty one sized for the settings at this sample rate, with
+    // numReferenceChannels sidechain channels in a ring of their own (none without a sidechain).
+    // Only call while neither the audio nor the analysis thread is running, e.g. from prepareToPlay().
+    void prepare(int _sampleRate, int numChannels, int _maxBlockSize, const AnalysisSettings& settings, int numReferenceChannels = 0)
+    {
+        sampleRate = _sampleRate;
+        maxBlockSize = juce::jmax(1, _maxBlockSize);
+
+        delete history.exchange(nullptr, std::memory_order_relaxed);
+        delete pendingHistory.exchange(nullptr, std::memory_order_relaxed);
+        delete retiredHistory.exchange(nullptr, std::memory_order_relaxed);
+
+        history.store(new CaptureHistory(numChannels, numReferenceChannels, getCapacityFor(getAnalysisWindow(settings))), std::memory_order_release);
+
+        // Positions start over at zero
+        channelAnalyses.clear();
+        heldLevels.clear();
+    }
+
+    // Push audio data to the circular buffer. Audio thread only.
+    void pushAudioData(const float* source, int numSamples, int channel)
+    {
+        if (pendingHistory.load(std::memory_order_acquire) != nullptr)
+            adoptPendingHistory();
+
+        if (CaptureHistory* current = history.load(std::memory_order_relaxed))
+            current->push(source, numSamples, channel);
+    }
+
+    // Push sidechain data to the reference ring. Audio thread only, with the same block sizes as pushAudioData().
+    void pushReferenceData(const float* source, int numSamples, int channel)
+    {
+        if (pendingHistory.load(std::memory_order_acquire) != nullptr)
+            adoptPendingHistory();
+
+        if (CaptureHistory* current = history.load(std::memory_order_relaxed))
+            current->reference->push(source, numSamples, channel);
+    }
+
+    // Lets per-channel spectra run on the pool's idle workers; without one they are computed one after another
+    void setParallelScheduler(AnalysisScheduler* _scheduler)
+    {
+        scheduler = _scheduler;
+    }
+
+    // Channels the capture history holds, 0 before prepare()
+    int getNumChannels() const
+    {
+        const CaptureHistory* current = history.load(std::memory_order_acquire);
+        return current != nullptr ? current->ring.getNumChannels() : 0;
+    }
+
+    // Sidechain channels the reference ring holds, 0 without a sidechain
+    int getNumReferenceChannels() const
+    {
+        const CaptureHistory* current = history.load(std::memory_order_acquire);
+        return current != nullptr && current->reference != nullptr ? current->reference->getNumChannels() : 0;
+    }
+
+    // Runs the whole analysis for one frame. Only call from the analysis thread.
+    void analyse(const AnalysisSettings& settings, AnalysisResult& result)
+    {
+        if (history.load(std::memory_order_acquire) == nullptr)
+            return;
+
+        // The bus layout may have shrunk since the editor picked the channel
+        if (settings.channel < 0 || settings.channel >= getNumChannels())
+        {
+            AnalysisSettings firstChannel = settings;
+            firstChannel.channel = 0;
+            analyse(firstChannel, result);
+            return;
+        }
+
+        resizeHistoryIfNeeded(settings);
+
+        readWaveform(settings.waveformSamples, settings.waveformColumns, settings.channel, result);
+        computeSpectrum(settings, result);
+        result.lowPassFrequency = settings.lowPassFrequency;
+    }
+
+    // Bumped on every push: the analysis only needs to run again once this has moved
+    uint64_t getWriteSequence() const
+    {
+        const CaptureHistory* current = history.load(std::memory_order_acquire);
+        return current != nullptr ? current->ring.getWriteSequence() : 0;
+    }
+
+    // True if every sample the analysis with these settings looks at is silence
+    bool isInputSilent(const AnalysisSettings& settings) const
+    {
+        const CaptureHistory* current = history.load(std::memory_order_acquire);
+        if (current == nullptr)
+            return true;
+
+        // The multi-rate estimates remember far more than they read from the ring at a time
+        uint64_t spectrumSpan = 0;
+        if (settings.peakHoldMode != -1 && settings.spectrumEngine == SpectrumEngine::constantQ)
+            spectrumSpan = ConstantQAnalyzer::getSpanSamples(getConstantQConfig(settings, settings.channel));
+        else if (settings.peakHoldMode != -1 && settings.spectrumEngine == SpectrumEngine::zoom)
+            spectrumSpan = ZoomFFTAnalyzer::getSpanSamples(getZoomConfig(settings, settings.channel));
+
+        const uint64_t window = std::max((uint64_t)getAnalysisWindow(settings), spectrumSpan);
+
+        // The waveform reads only the soloed channel, an overlaid spectrum all of them, a stereo one the next channel too
+        const bool isStereo = settings.peakHoldMode != -1 && isMidSide(settings, *current);
+
+        for (int channel = 0; channel < current->ring.getNumChannels(); ++channel)
+        {
+            const bool isRead = channel == settings.channel || (settings.overlayChannels && settings.peakHoldMode != -1)
+                             || (isStereo && channel == settings.channel + 1);
+            if (isRead && current->ring.getSilentSamples(channel) < window)
+                return false;
+        }
+
+        // A comparison also reads the reference
+        if (settings.peakHoldMode != -1 && isReference(settings, *current)
+            && current->reference->getSilentSamples(getReferenceChannel(settings, *current)) < window)
+            return false;
+
+        return true;
+    }
+
+    // Number of most recent samples per channel the analysis with these settings reads
+    int getAnalysisWindow(const AnalysisSettings& settings) const
+    {
+        int spectrumWindow = 0;
+
+        // The multi-rate engines only stream new samples, but must not fall further behind than half a second
+        if (settings.peakHoldMode != -1)
+            spectrumWindow = settings.spectrumEngine != SpectrumEngine::stft
+                               ? sampleRate / 2
+                               : (1 << settings.stftFrameOrder) + settings.stftHopSize * (getNumFramesRead(settings) - 1);
+
+        return juce::jmax(settings.waveformSamples, spectrumWindow);
+    }
+
+    // Samples per channel the capture history currently holds
+    int getCapacity() const
+    {
+        const CaptureHistory* current = history.load(std::memory_order_acquire);
+        return current != nullptr ? current->ring.getCapacity() : 0;
+    }
+
+    // True if the result shows nothing but silence: a flat waveform and a spectrum at its floor
+    static bool isSilent(const AnalysisResult& result)
+    {
+        for (size_t i = 0; i < result.waveformMin.size(); ++i)
+        {
+            if (std::max(-result.waveformMin[i], result.waveformMax[i]) > CircularBuffer::silenceThreshold)
+                return false;
+        }
+
+        // A difference row is not a level
+        const size_t numLevels = result.spectrum.size() - (result.isReference ? (size_t)result.spectrumColumns : 0);
+
+        for (size_t i = 0; i < numLevels; ++i)
+        {
+            if (result.spectrum[i] > result.spectrumMinDecibels)
+                return false;
+        }
+
+        return true;
+    }
+
+    // Coordinates a path needs per segment: a start point and a line, each a marker plus x and y
+    static constexpr int coordinatesPerSegment = 6;
+
+    // Turns the waveform of an analysis result into geometry: one vertical min/max stroke per column.
+    // The path is cleared and refilled in place, so it keeps its storage from one frame to the next.
+    static void buildVisualizationPath(const AnalysisResult& result, int height, int width, FrameArena& arena, juce::Path& path)
+    {
+        path.clear();
+
+        const int numColumns = (int)result.waveformMin.size();
+        if (numColumns == 0)
+            return;
+
+        path.preallocateSpace(numColumns * coordinatesPerSegment);
+
+        // Normalize both envelopes to fit the height in one pass each
+        const float halfHeight = 0.5f * static_cast<float>(height);
+        float* yMin = arena.allocate<float>(numColumns);
+        float* yMax = arena.allocate<float>(numColumns);
+        juce::FloatVectorOperations::multiply(yMin, result.waveformMin.data(), halfHeight, numColumns);
+        juce::FloatVectorOperations::add(yMin, halfHeight, numColumns);
+        juce::FloatVectorOperations::multiply(yMax, result.waveformMax.data(), halfHeight, numColumns);
+        juce::FloatVectorOperations::add(yMax, halfHeight, numColumns);
+
+        const float xStep = static_cast<float>(width) / numColumns; // Evenly space the columns across the width
+        float x = 0.5f * xStep; // Initialize horizontal position tracker
+
+        // Create the waveform path
+        for (int i = 0; i < numColumns; ++i)
+        {
+            path.startNewSubPath(x, yMin[i]);
+            path.lineTo(x, yMax[i]);
+
+            x += xStep;
+        }
+    }
+
+    // Turns one row of the spectrum of an analysis result into geometry, refilling the path in place.
+    // A difference row is drawn around the middle of the view, with the same dB scale. The cutoff line
+    // is only added to row 0.
+    static void buildSpectrumPath(const AnalysisResult& result, int height, int width, FrameArena& arena, juce::Path& path, int row = 0)
+    {
+        path.clear();
+
+        if (result.fftSize == 0 || row >= result.numSpectrumChannels || result.numDrawnColumns == 0) {
+            return;
+        }
+
+        const int numSamples = result.fftSize;
+        const int numBins = numSamples / 2;
+        const int numColumns = result.spectrumColumns;
+        const int numDrawnColumns = result.numDrawnColumns;
+        const float decibelScale = 1.0f / (result.spectrumMaxDecibels - result.spectrumMinDecibels);
+
+        // One point per column plus the cutoff line
+        path.preallocateSpace((numColumns + 1) * coordinatesPerSegment / 2 + coordinatesPerSegment);
+
+        // Map to visual space: y = height * (1 - normalised level)
+        const bool isDifference = result.isReference && row == 2;
+        const float offset = isDifference ? 0.5f * (result.spectrumMaxDecibels - result.spectrumMinDecibels) : -result.spectrumMinDecibels;
+        float* y = arena.allocate<float>(numColumns);
+        juce::FloatVectorOperations::add(y, result.getSpectrumRow(row), offset, numColumns);
+        juce::FloatVectorOperations::multiply(y, decibelScale, numColumns);
+        juce::FloatVectorOperations::clip(y, y, 0.0f, 1.0f, numColumns);
+        juce::FloatVectorOperations::multiply(y, -static_cast<float>(height), numColumns);
+        juce::FloatVectorOperations::add(y, static_cast<float>(height), numColumns);
+
+        // Start drawing the spectrum, one point per column up to the last one holding a bin
+        for (int i = 0; i < numDrawnColumns; ++i)
+        {
+            float x = width * (i + 0.5f) / numColumns;
+
+            if (i == 0)
+                path.startNewSubPath(x, y[i]); // Start at the first point
+            else
+                path.lineTo(x, y[i]); // Draw line to the next point
+
+        }
+
+        if (row != 0)
+            return;
+
+        // Add a vertical line at the cutoff frequency, if it falls inside a zoomed band
+        if (result.lowPassFrequency > 0.0f && result.zoomHighFrequency > result.zoomLowFrequency) {
+            const float position = (result.lowPassFrequency - result.zoomLowFrequency) / (result.zoomHighFrequency - result.zoomLowFrequency);
+
+            if (position >= 0.0f && position <= 1.0f) {
+                path.startNewSubPath(width * position, 0);
+                path.lineTo(width * position, height);
+            }
+        }
+        else if (result.lowPassFrequency > 0.0f) {
+            // Calculate x position for the cutoff frequency
+            int cutoffBin = static_cast<int>((result.lowPassFrequency * numSamples) / 20000);
+            cutoffBin = std::clamp(cutoffBin, 0, numBins - 1); // Make sure the bin is within range
+
+            float cutoffX = SpectrumBinMap::binToX((float)cutoffBin, numSamples, width);
+
+            // Create a new subpath for the vertical line
+            path.startNewSubPath(cutoffX, 0);  // Start at the top of the window
+            path.lineTo(cutoffX, height); // End at the bottom of the window
+        }
+    }
+
+    void setSampleRate(int _sampleRate)
+    {
+        sampleRate = _sampleRate;
+    }
+
+private:
+    // The ring, the per-channel waveform summaries and the sidechain reference, always replaced together
+    struct CaptureHistory
+    {
+        CaptureHistory(int numChannels, int numReferenceChannels, int capacity)
+            : ring(numChannels, capacity)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                pyramids.push_back(std::make_unique<WaveformPyramid>(capacity / WaveformPyramid::baseBlockSize));
+
+            if (numReferenceChannels > 0)
+                reference = std::make_unique<CircularBuffer>(numReferenceChannels, capacity);
+        }
+
+        void push(const float* source, int numSamples, int channel)
+        {
+            ring.push(source, numSamples, channel);
+            pyramids[channel]->push(source, numSamples);
+        }
+
+        int getNumReferenceChannels() const { return reference != nullptr ? reference->getNumChannels() : 0; }
+
+        CircularBuffer ring;
+        std::vector<std::unique_ptr<WaveformPyramid>> pyramids; ///< One min/max summary per captured channel.
+        std::unique_ptr<CircularBuffer> reference;              ///< Sidechain channels, or null without a sidechain.
+    };
+
+    static constexpr int maxAdoptedSamples = 16384; ///< Most samples the audio thread copies when adopting a history.
+    static constexpr int maxCatchUpFrames = 8;      ///< Most frames an exponential average transforms after falling behind; older hops are folded in with the first.
+
+    // The window plus a quarter of headroom for audio that lands while the analysis reads, in whole pyramid blocks
+    int getCapacityFor(int window) const
+    {
+        const int capacity = juce::jmax(window + window / 4, 2 * maxBlockSize);
+        return (capacity + WaveformPyramid::baseBlockSize - 1) / WaveformPyramid::baseBlockSize * WaveformPyramid::baseBlockSize;
+    }
+
+    CaptureHistory& getHistory() const
+    {
+        return *history.load(std::memory_order_acquire);
+    }
+
+    // Analysis thread: hands a resized history to the audio thread if the window outgrew the current one,
+    // or if it now uses less than a quarter of it. Growth at least doubles, so dragging a knob does not
+    // resize on every pass.
+    void resizeHistoryIfNeeded(const AnalysisSettings& settings)
+    {
+        // The audio thread clears pending only after it stored the history it replaced as retired
+        if (pendingHistory.load(std::memory_order_acquire) != nullptr)
+            return;
+
+        delete retiredHistory.exchange(nullptr, std::memory_order_acquire);
+
+        const CaptureHistory& current = getHistory();
+        const int capacity = current.ring.getCapacity();
+        const int needed = getCapacityFor(getAnalysisWindow(settings));
+
+        int newCapacity = capacity;
+        if (needed > capacity)
+            newCapacity = juce::jmax(needed, 2 * capacity);
+        else if (needed < capacity / 4)
+            newCapacity = 2 * needed;
+
+        if (newCapacity != capacity)
+            pendingHistory.store(createResizedHistory(current, newCapacity), std::memory_order_release);
+    }
+
+    // Analysis thread: a history of the given capacity that continues where source is, holding as much
+    // of its recent audio as fits
+    static CaptureHistory* createResizedHistory(const CaptureHistory& source, int capacity)
+    {
+        const int numChannels = source.ring.getNumChannels();
+        auto* resized = new CaptureHistory(numChannels, source.getNumReferenceChannels(), capacity);
+        std::vector<float> samples;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            resized->ring.startChannelAt(channel, readRecent(source.ring, capacity, channel, samples));
+
+            if (! samples.empty())
+                resized->push(samples.data(), (int)samples.size(), channel);
+        }
+
+        for (int channel = 0; channel < source.getNumReferenceChannels(); ++channel)
+        {
+            resized->reference->startChannelAt(channel, readRecent(*source.reference, capacity, channel, samples));
+
+            if (! samples.empty())
+                resized->reference->push(samples.data(), (int)samples.size(), channel);
+        }
+
+        return resized;
+    }
+
+    // Copies up to capacity of the most recent samples of a channel into samples; returns the position of the first
+    static uint64_t readRecent(const CircularBuffer& source, int capacity, int channel, std::vector<float>& samples)
+    {
+        CircularBuffer::Snapshot snapshot;
+
+        for (int attempt = 0; attempt < CircularBuffer::maxReadAttempts; ++attempt)
+        {
+            snapshot = source.getSnapshot(juce::jmin(capacity, source.getCapacity()), channel);
+            samples.assign(snapshot.head, snapshot.head + snapshot.headSize);
+            samples.insert(samples.end(), snapshot.tail, snapshot.tail + snapshot.tailSize);
+
+            if (source.isValid(snapshot))
+                break;
+        }
+
+        return snapshot.sequence - (uint64_t)snapshot.size();
+    }
+
+    // Audio thread: copies what was pushed since the pending history was filled, then swaps it in.
+    // If that is more than a bounded copy (the analysis thread stalled in between), it is dropped
+    // instead and the analysis thread builds a new one.
+    void adoptPendingHistory()
+    {
+        CaptureHistory* pending = pendingHistory.load(std::memory_order_acquire);
+        CaptureHistory* current = history.load(std::memory_order_relaxed);
+        bool canAdopt = canCatchUp(current->ring, pending->ring);
+
+        if (canAdopt && current->reference != nullptr)
+            canAdopt = canCatchUp(*current->reference, *pending->reference);
+
+        if (canAdopt)
+        {
+            for (int channel = 0; channel < current->ring.getNumChannels(); ++channel)
+            {
+                const CircularBuffer::Snapshot snapshot = getMissing(current->ring, pending->ring, channel);
+
+                // This thread is the ring's only writer, so the snapshot cannot tear
+                if (snapshot.headSize > 0)
+                    pending->push(snapshot.head, snapshot.headSize, channel);
+
+                if (snapshot.tailSize > 0)
+                    pending->push(snapshot.tail, snapshot.tailSize, channel);
+            }
+
+            for (int channel = 0; channel < current->getNumReferenceChannels(); ++channel)
+            {
+                const CircularBuffer::Snapshot snapshot = getMissing(*current->reference, *pending->reference, channel);
+
+                if (snapshot.headSize > 0)
+                    pending->reference->push(snapshot.head, snapshot.headSize, channel);
+
+                if (snapshot.tailSize > 0)
+                    pending->reference->push(snapshot.tail, snapshot.tailSize, channel);
+            }
+
+            history.store(pending, std::memory_order_release);
+        }
+
+        retiredHistory.store(canAdopt ? current : pending, std::memory_order_relaxed);
+        pendingHistory.store(nullptr, std::memory_order_release);
+    }
+
+    // True if every channel of to lags behind from by no more than one bounded copy
+    static bool canCatchUp(const CircularBuffer& from, const CircularBuffer& to)
+    {
+        for (int channel = 0; channel < from.getNumChannels(); ++channel)
+        {
+            if (from.getWritePosition(channel) - to.getWritePosition(channel)
+                > (uint64_t)juce::jmin(maxAdoptedSamples, from.getCapacity(), to.getCapacity()))
+                return false;
+        }
+
+        return true;
+    }
+
+    // The samples of a channel that from holds and to does not have yet
+    static CircularBuffer::Snapshot getMissing(const CircularBuffer& from, const CircularBuffer& to, int channel)
+    {
+        const uint64_t end = from.getWritePosition(channel);
+        return from.getSnapshotEndingAt(end, (int)(end - to.getWritePosition(channel)), channel);
+    }
+
+    // True if the spectrum compares a channel with the reference: asked for, STFT engine, and a sidechain to read
+    static bool isReference(const AnalysisSettings& settings, const CaptureHistory& current)
+    {
+        return settings.compareReference && ! settings.overlayChannels && settings.spectrumEngine == SpectrumEngine::stft
+            && current.getNumReferenceChannels() > 0;
+    }
+
+    // Reference channel a channel is compared with: the same one, or the last if the sidechain has fewer
+    static int getReferenceChannel(const AnalysisSettings& settings, const CaptureHistory& current)
+    {
+        return juce::jmin(settings.channel, current.getNumReferenceChannels() - 1);
+    }
+
+    // True if the spectrum is the packed stereo one: asked for, STFT engine, and a channel to pair with
+    static bool isMidSide(const AnalysisSettings& settings, const CaptureHistory& current)
+    {
+        return settings.stereoMidSide && ! settings.overlayChannels && settings.spectrumEngine == SpectrumEngine::stft
+            && settings.channel + 1 < current.ring.getNumChannels() && ! isReference(settings, current);
+    }
+
+    int getNumFramesAveraged(const AnalysisSettings& settings) const
+    {
+        return juce::jmax(1, (int)(sampleRate * settings.fallbackSpeed) / settings.stftHopSize);
+    }
+
+    // Frames the STFT reads back per pass: all of a linear average, but an exponential one only catches
+    // up on the latest few, whatever its time constants. The paired views always average linearly.
+    int getNumFramesRead(const AnalysisSettings& settings) const
+    {
+        const bool isPaired = ! settings.overlayChannels && (settings.stereoMidSide || settings.compareReference);
+
+        if (settings.averaging == SpectrumAveraging::exponential && ! isPaired)
+            return maxCatchUpFrames;
+
+        return getNumFramesAveraged(settings);
+    }
+
+    void readWaveform(int numSamples, int numColumns, int channel, AnalysisResult& result)
+    {
+        result.waveformMin.resize(numColumns);
+        result.waveformMax.resize(numColumns);
+        result.waveformRms.resize(numColumns);
+
+        // Until a grown history has been adopted the current one may be shorter than asked for
+        CaptureHistory& current = getHistory();
+        numSamples = juce::jmin(numSamples, current.ring.getCapacity());
+
+        // Only the pyramid level matching the column width is touched
+        current.pyramids[channel]->getColumns(current.ring, channel, numSamples, numColumns,
+                                              result.waveformMin.data(), result.waveformMax.data(), result.waveformRms.data());
+    }
+
+    // Holds and releases the first numValues per-column levels by the audio time that passed since the last
+    // call, so the ballistics do not depend on how often the analysis runs. Every row is held on its own.
+    void applyPeakHold(const AnalysisSettings& settings, AnalysisResult& result, int numValues)
+    {
+        std::vector<float>& levels = result.spectrum;
+        const uint64_t position = getHistory().ring.getWritePosition(settings.channel);
+        const int rowsKey = settings.overlayChannels ? -1 : (result.isMidSide ? -2 - settings.channel : settings.channel);
+
+        if (settings.peakHoldMode <= 0)
+        {
+            heldLevels.clear(); // Starts from scratch when switched back on
+            return;
+        }
+
+        // A column holds a different frequency once the engine, the frame size or the zoomed band changes
+        const bool isSameAxis = settings.spectrumEngine == peakHoldEngine && result.fftSize == peakHoldFftSize
+                             && result.zoomLowFrequency == peakHoldLowFrequency && result.zoomHighFrequency == peakHoldHighFrequency;
+
+        if ((int)heldLevels.size() != numValues || rowsKey != peakHoldRows || ! isSameAxis)
+        {
+            heldLevels.assign(numValues, settings.spectrumMinDecibels);
+            holdTimers.assign(numValues, 0.0f);
+            peakHoldRows = rowsKey;
+            peakHoldEngine = settings.spectrumEngine;
+            peakHoldFftSize = result.fftSize;
+            peakHoldLowFrequency = result.zoomLowFrequency;
+            peakHoldHighFrequency = result.zoomHighFrequency;
+            peakHoldPosition = position;
+        }
+
+        const float elapsedSeconds = sampleRate > 0 ? (float)(position - peakHoldPosition) / sampleRate : 0.0f;
+        peakHoldPosition = position;
+
+        SpectrumKernels::peakHold(levels.data(), heldLevels.data(), holdTimers.data(), numValues,
+                                  elapsedSeconds, peakHoldSeconds[settings.peakHoldMode], settings.peakReleaseDecibelsPerSecond);
+
+        std::copy(heldLevels.begin(), heldLevels.end(), levels.begin());
+    }
+
+    // The spectrum engines of one captured channel, with their own scratch so channels can run concurrently
+    struct ChannelAnalysis
+    {
+        FFTEngine fftEngine;
+        StftAnalyzer stft;
+        ConstantQAnalyzer constantQ;
+        ZoomFFTAnalyzer zoomFFT;
+        StereoStftAnalyzer stereo;     ///< Only used on the left channel of a pair.
+        StereoStftAnalyzer reference;  ///< This channel packed with its reference.
+        SpectrumBinMap binMap;
+        std::vector<float> magnitudes;
+    };
+
+    // One item per spectrum row
+    struct SpectrumJob : AnalysisScheduler::ParallelJob
+    {
+        SpectrumJob(AudioVisualizationProcessor& _owner, const AnalysisSettings& _settings, AnalysisResult& _result, int _axisSize)
+            : owner(_owner), settings(_settings), result(_result), axisSize(_axisSize)
+        {
+        }
+
+        void runItem(int row) override
+        {
+            const int channel = result.soloChannel >= 0 ? result.soloChannel : row;
+            float* columnValues = result.spectrum.data() + (size_t)row * settings.spectrumColumns;
+            frameSize = owner.computeColumns(settings, *owner.channelAnalyses[channel], channel, axisSize, columnValues);
+        }
+
+        AudioVisualizationProcessor& owner;
+        const AnalysisSettings& settings;
+        AnalysisResult& result;
+        const int axisSize;
+        std::atomic<int> frameSize { 0 }; ///< Same for every row.
+    };
+
+    void computeSpectrum(const AnalysisSettings& settings, AnalysisResult& result)
+    {
+        const int peakHoldMode = settings.peakHoldMode;
+
+        if (peakHoldMode == -1) {
+            result.fftSize = 0;
+            result.numSpectrumChannels = 0;
+            result.spectrum.clear();
+            return;
+        }
+
+        // Every engine lays its columns out on the log axis of the STFT frame size
+        const int axisSize = 1 << settings.stftFrameOrder;
+        const int numChannels = getHistory().ring.getNumChannels();
+
+        while ((int)channelAnalyses.size() < numChannels)
+            channelAnalyses.push_back(std::make_unique<ChannelAnalysis>());
+
+        result.isReference = isReference(settings, getHistory());
+        result.isMidSide = isMidSide(settings, getHistory());
+        result.soloChannel = settings.overlayChannels ? -1 : juce::jlimit(0, numChannels - 1, settings.channel);
+        result.numSpectrumChannels = settings.overlayChannels ? numChannels
+                                   : result.isMidSide ? (int)StereoStftAnalyzer::numSpectra
+                                   : result.isReference ? 3 : 1;
+        result.spectrumColumns = settings.spectrumColumns;
+        result.fftSize = axisSize;
+        result.numDrawnColumns = settings.spectrumEngine == SpectrumEngine::zoom
+                               ? settings.spectrumColumns
+                               : SpectrumBinMap::getNumColumnsWithBins(axisSize, settings.spectrumColumns);
+        result.spectrum.resize((size_t)result.numSpectrumChannels * settings.spectrumColumns);
+
+        result.zoomLowFrequency = 0.0f;
+        result.zoomHighFrequency = 0.0f;
+
+        if (settings.spectrumEngine == SpectrumEngine::zoom)
+        {
+            result.zoomLowFrequency = (float)ZoomFFTAnalyzer::getLowFrequency(getZoomConfig(settings, 0));
+            result.zoomHighFrequency = (float)ZoomFFTAnalyzer::getHighFrequency(getZoomConfig(settings, 0));
+        }
+
+        // Channels share nothing but the immutable FFT plans, so their rows are independent
+        SpectrumJob job(*this, settings, result, axisSize);
+
+        if (result.isMidSide)
+        {
+            // All four rows come out of the same transforms
+            job.frameSize = computeMidSideColumns(settings, *channelAnalyses[result.soloChannel], result.soloChannel, result.spectrum.data());
+        }
+        else if (result.isReference)
+        {
+            // So do the channel and its reference; the third row is filled in below
+            job.frameSize = computeReferenceColumns(settings, *channelAnalyses[result.soloChannel], result.soloChannel, result.spectrum.data());
+        }
+        else if (scheduler != nullptr)
+        {
+            scheduler->runInParallel(job, result.numSpectrumChannels);
+        }
+        else
+        {
+            for (int row = 0; row < result.numSpectrumChannels; ++row)
+                job.runItem(row);
+        }
+
+        // Convert to dB relative to a full-scale sine, whose magnitude is frameSize / 2
+        const int numValues = (int)result.spectrum.size() - (result.isReference ? settings.spectrumColumns : 0);
+        juce::FloatVectorOperations::multiply(result.spectrum.data(), 2.0f / job.frameSize.load(), numValues);
+        SpectrumKernels::amplitudeToDecibels(result.spectrum.data(), result.spectrum.data(), numValues, settings.spectrumMinDecibels);
+
+        applyPeakHold(settings, result, numValues);
+
+        // What the channel has more of than the reference, from the levels as shown
+        if (result.isReference)
+            juce::FloatVectorOperations::subtract(result.spectrum.data() + 2 * settings.spectrumColumns, result.getSpectrumRow(0),
+                                                  result.getSpectrumRow(1), settings.spectrumColumns);
+
+        result.spectrumMinDecibels = settings.spectrumMinDecibels;
+        result.spectrumMaxDecibels = settings.spectrumMaxDecibels;
+    }
+
+    // Writes one channel's column magnitudes with the selected engine; returns the frame size they are scaled to
+    int computeColumns(const AnalysisSettings& settings, ChannelAnalysis& analysis, int channel, int axisSize, float* columnValues)
+    {
+        if (settings.spectrumEngine == SpectrumEngine::constantQ)
+            return computeConstantQColumns(settings, analysis, channel, axisSize, columnValues);
+
+        if (settings.spectrumEngine == SpectrumEngine::zoom)
+            return computeZoomColumns(settings, analysis, channel, columnValues);
+
+        return computeStftColumns(settings, analysis, channel, columnValues);
+    }
+
+    // Writes the column magnitudes of the STFT estimate; returns the frame size they are scaled to
+    int computeStftColumns(const AnalysisSettings& settings, ChannelAnalysis& analysis, int channel, float* columnValues)
+    {
+        // The fall-back time is covered by averaging hop-spaced frames rather than by one huge transform
+        StftAnalyzer::Config config;
+        config.frameOrder = settings.stftFrameOrder;
+        config.hopSize = settings.stftHopSize;
+        config.window = settings.windowType;
+        config.channel = channel;
+        config.averaging = settings.averaging;
+        config.numFramesAveraged = settings.averaging == SpectrumAveraging::exponential ? maxCatchUpFrames : getNumFramesAveraged(settings);
+        config.sampleRate = sampleRate;
+        config.attackSeconds = settings.attackSeconds;
+        config.releaseSeconds = (float)settings.fallbackSpeed;
+        analysis.stft.configure(config);
+
+        // Only the frames that completed since the last call are transformed
+        analysis.stft.process(getHistory().ring, analysis.fftEngine);
+
+        const int numSamples = analysis.stft.getFrameSize();
+        int numBins = analysis.stft.getNumBins();
+        analysis.magnitudes.resize(numBins);
+        analysis.stft.getMagnitudes(analysis.magnitudes.data());
+
+        // Reduce the bins to one value per display column
+        analysis.binMap.prepare(numSamples, settings.spectrumColumns);
+        analysis.binMap.reduce(analysis.magnitudes.data(), columnValues, SpectrumBinMap::Reduction::peak);
+        return numSamples;
+    }
+
+    // Writes the left, right, mid and side rows of a channel pair, one packed transform per frame;
+    // returns the frame size they are scaled to
+    int computeMidSideColumns(const AnalysisSettings& settings, ChannelAnalysis& analysis, int leftChannel, float* rows)
+    {
+        StereoStftAnalyzer::Config config;
+        config.frameOrder = settings.stftFrameOrder;
+        config.hopSize = settings.stftHopSize;
+        config.window = settings.windowType;
+        config.numFramesAveraged = getNumFramesAveraged(settings);
+        config.leftChannel = leftChannel;
+        config.rightChannel = leftChannel + 1;
+        analysis.stereo.configure(config);
+
+        analysis.stereo.process(getHistory().ring, analysis.fftEngine);
+
+        const int numSamples = analysis.stereo.getFrameSize();
+        analysis.magnitudes.resize(analysis.stereo.getNumBins());
+        analysis.binMap.prepare(numSamples, settings.spectrumColumns);
+
+        for (int spectrum = 0; spectrum < StereoStftAnalyzer::numSpectra; ++spectrum)
+        {
+            analysis.stereo.getMagnitudes((StereoStftAnalyzer::Spectrum)spectrum, analysis.magnitudes.data());
+            analysis.binMap.reduce(analysis.magnitudes.data(), rows + (size_t)spectrum * settings.spectrumColumns, SpectrumBinMap::Reduction::peak);
+        }
+
+        return numSamples;
+    }
+
+    // Writes the rows of a channel and of its reference, packed into one transform per frame;
+    // returns the frame size they are scaled to
+    int computeReferenceColumns(const AnalysisSettings& settings, ChannelAnalysis& analysis, int channel, float* rows)
+    {
+        CaptureHistory& current = getHistory();
+
+        StereoStftAnalyzer::Config config;
+        config.frameOrder = settings.stftFrameOrder;
+        config.hopSize = settings.stftHopSize;
+        config.window = settings.windowType;
+        config.numFramesAveraged = getNumFramesAveraged(settings);
+        config.leftChannel = channel;
+        config.rightChannel = getReferenceChannel(settings, current);
+        config.withMidSide = false;
+        analysis.reference.configure(config);
+
+        analysis.reference.process(current.ring, *current.reference, analysis.fftEngine);
+
+        const int numSamples = analysis.reference.getFrameSize();
+        analysis.magnitudes.resize(analysis.reference.getNumBins());
+        analysis.binMap.prepare(numSamples, settings.spectrumColumns);
+
+        analysis.reference.getMagnitudes(StereoStftAnalyzer::left, analysis.magnitudes.data());
+        analysis.binMap.reduce(analysis.magnitudes.data(), rows, SpectrumBinMap::Reduction::peak);
+        analysis.reference.getMagnitudes(StereoStftAnalyzer::right, analysis.magnitudes.data());
+        analysis.binMap.reduce(analysis.magnitudes.data(), rows + settings.spectrumColumns, SpectrumBinMap::Reduction::peak);
+        return numSamples;
+    }
+
+    // Writes the column magnitudes of the constant-Q estimate; returns the frame size they are scaled to
+    int computeConstantQColumns(const AnalysisSettings& settings, ChannelAnalysis& analysis, int channel, int axisSize, float* columnValues)
+    {
+        analysis.constantQ.configure(getConstantQConfig(settings, channel));
+
+        // Only the samples that arrived since the last call run through the decimator cascade
+        analysis.constantQ.process(getHistory().ring, analysis.fftEngine);
+        analysis.constantQ.getColumns(axisSize, settings.spectrumColumns, columnValues);
+        return ConstantQAnalyzer::getFrameSize();
+    }
+
+    // Writes the column magnitudes of the zoomed band; returns the frame size they are scaled to
+    int computeZoomColumns(const AnalysisSettings& settings, ChannelAnalysis& analysis, int channel, float* columnValues)
+    {
+        analysis.zoomFFT.configure(getZoomConfig(settings, channel));
+
+        // Only the samples that arrived since the last call are mixed down and decimated
+        analysis.zoomFFT.process(getHistory().ring, analysis.fftEngine);
+        analysis.zoomFFT.getColumns(settings.spectrumColumns, columnValues);
+        return ZoomFFTAnalyzer::getFrameSize();
+    }
+
+    ZoomFFTAnalyzer::Config getZoomConfig(const AnalysisSettings& settings, int channel) const
+    {
+        ZoomFFTAnalyzer::Config config;
+        config.sampleRate = sampleRate;
+        config.centreFrequency = settings.zoomCentreFrequency;
+        config.span = settings.zoomSpan;
+        config.averagingSeconds = settings.fallbackSpeed;
+        config.window = settings.windowType;
+        config.channel = channel;
+        return config;
+    }
+
+    ConstantQAnalyzer::Config getConstantQConfig(const AnalysisSettings& settings, int channel) const
+    {
+        ConstantQAnalyzer::Config config;
+        config.sampleRate = sampleRate;
+        config.averagingSeconds = settings.fallbackSpeed;
+        config.window = settings.windowType;
+        config.channel = channel;
+        return config;
+    }
+
+    float peakHoldSeconds[4]; ///< Hold time per peak hold mode.
+
+    int sampleRate = 0;
+    int maxBlockSize = 1;                                   ///< Largest push the history must take at once.
+    std::atomic<CaptureHistory*> history { nullptr };       ///< Written to by the audio thread; swapped only by it.
+    std::atomic<CaptureHistory*> pendingHistory { nullptr }; ///< Resized history waiting for the audio thread.
+    std::atomic<CaptureHistory*> retiredHistory { nullptr }; ///< Replaced history, freed by the analysis thread.
+
+    std::vector<std::unique_ptr<ChannelAnalysis>> channelAnalyses; ///< Indexed by captured channel, created on first use.
+    AnalysisScheduler* scheduler = nullptr;
+
+    std::vector<float> heldLevels;  ///< Peak-held level per display column, in dB.
+    std::vector<float> holdTimers;  ///< Hold time left per display column, in seconds.
+    uint64_t peakHoldPosition = 0;  ///< Ring write position the held levels were last advanced to.
+    int peakHoldRows = 0;           ///< Channel the held levels belong to, -1 for one row per channel, -2 - channel for a stereo pair.
+    SpectrumEngine peakHoldEngine = SpectrumEngine::stft; ///< Axis the held levels were measured on...
+    int peakHoldFftSize = 0;
+    float peakHoldLowFrequency = 0.0f;
+    float peakHoldHighFrequency = 0.0f; ///< ...up to here.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioVisualizationProcessor)
+};
@@ -1,37 +1,103 @@
-#pragma once
-
-#include <JuceHeader.h>
-
-class AudioVisualizer : public juce::Component
-{
-public:
-    explicit AudioVisualizer(int _width, int _height)
-    {
-        width = _width;
-        height = _height;
-        setSize(width, height);
-    }
-
-    // Set the waveform Path to be drawn
-    void setWaveformPath(const juce::Path& path)
-    {
-        waveformPath = path;
-        repaint();  // Trigger a repaint whenever the waveform is updated
-    }
-
-    // Draw the waveform in the component
-    void paint(juce::Graphics& g) override
-    {
-        g.fillAll(juce::Colours::black);  // Set background color to black
-        g.setColour(juce::Colours::green);  // Set waveform color to green
-
-        g.strokePath(waveformPath, juce::PathStrokeType(2.0f));  // Draw the waveform
-    }
-
-private:
-    int width;
-    int height;
-    juce::Path waveformPath;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioVisualizer)
-};
+#pragma once
+
+#include <JuceHeader.h>
+#include <memory>
+#include <vector>
+
+class AudioVisualizer : public juce::Component
+{
+public:
+    explicit AudioVisualizer(int _width, int _height)
+    {
+        width = _width;
+        height = _height;
+        setSize(width, height);
+        setNumLayers(1);
+    }
+
+    // Number of curves drawn on top of each other; layer 0 is green, the others get their own hues.
+    // Grows the layers' storage, so call it outside the per-frame geometry update.
+    void setNumLayers(int _numLayers)
+    {
+        _numLayers = juce::jmax(1, _numLayers);
+
+        while ((int)layers.size() < _numLayers)
+        {
+            auto layer = std::make_unique<Layer>();
+            layer->colour = getLayerColour((int)layers.size());
+            layer->path.preallocateSpace(numPreallocatedCoordinates);
+            layer->backPath.preallocateSpace(numPreallocatedCoordinates);
+            layers.push_back(std::move(layer));
+        }
+
+        if (_numLayers != numLayers)
+        {
+            numLayers = _numLayers;
+            repaint();
+        }
+    }
+
+    int getNumLayers() const noexcept { return numLayers; }
+
+    // Reserves room for numCoordinates in every layer's paths, so filling them never has to grow them
+    void preallocatePaths(int numCoordinates)
+    {
+        numPreallocatedCoordinates = numCoordinates;
+
+        for (auto& layer : layers)
+        {
+            layer->path.preallocateSpace(numCoordinates);
+            layer->backPath.preallocateSpace(numCoordinates);
+        }
+    }
+
+    // The path to build the next frame's geometry of a layer in; it is not drawn until swapPaths()
+    juce::Path& getBackPath(int layer = 0) noexcept { return layers[(size_t)layer]->backPath; }
+
+    // Shows the back paths and hands the previous ones back for reuse, without copying any
+    void swapPaths()
+    {
+        for (int i = 0; i < numLayers; ++i)
+            layers[(size_t)i]->path.swapWithPath(layers[(size_t)i]->backPath);
+
+        repaint();  // Trigger a repaint whenever the waveform is updated
+    }
+
+    // Draw the waveform in the component
+    void paint(juce::Graphics& g) override
+    {
+        g.fillAll(juce::Colours::black);  // Set background color to black
+
+        // Layer 0 last, so the main curve stays on top
+        for (int i = numLayers; --i >= 0;)
+        {
+            g.setColour(layers[(size_t)i]->colour);
+            g.strokePath(layers[(size_t)i]->path, juce::PathStrokeType(i == 0 ? 2.0f : 1.5f));  // Draw the waveform
+        }
+    }
+
+    // Colour of a layer: green for the first, then evenly spread hues
+    static juce::Colour getLayerColour(int layer)
+    {
+        if (layer == 0)
+            return juce::Colours::green;
+
+        return juce::Colour::fromHSV(std::fmod(0.33f + 0.38f * layer, 1.0f), 0.7f, 1.0f, 0.85f);
+    }
+
+private:
+    struct Layer
+    {
+        juce::Path path;      ///< Drawn by paint().
+        juce::Path backPath;  ///< Filled by the editor, then swapped in.
+        juce::Colour colour;
+    };
+
+    int width;
+    int height;
+    std::vector<std::unique_ptr<Layer>> layers; ///< Only grows; the first numLayers are drawn.
+    int numLayers = 0;
+    int numPreallocatedCoordinates = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioVisualizer)
+};
@@ -1,111 +1,260 @@
-#pragma once
-
-#include <JuceHeader.h>
-#include <vector>
-#include <atomic>
-#include <cassert>
-
-/**
- * CircularBuffer class for managing a ring buffer of audio or other data.
- * @tparam T - The data type to be stored in the buffer (e.g., float, int).
- */
-class CircularBuffer
-{
-public:
-    explicit CircularBuffer(int numChannels, int capacity)
-        : buffer(numChannels, capacity), writeIndex(0), readIndex(0), bufferSize(capacity)
-    {
-        assert(capacity > 0 && "Capacity must be greater than zero");
-        buffer.clear(); // Ensure the buffer starts clean
-    }
-
-    void push(const float* data, int numSamples, int channel)
-    {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-
-        assert(data != nullptr && "Data pointer must not be null");
-        assert(numSamples <= bufferSize && "Cannot push more data at a time than buffer capacity");
-        assert(channel >= 0 && channel < buffer.getNumChannels() && "Invalid channel index");
-
-        if (numSamples + writeIndex <= bufferSize) // Data fits completely within buffer
-        {
-            buffer.copyFrom(channel, writeIndex, data, numSamples);
-        }
-        else
-        {
-            // Compute how many samples to write at the end of the buffer
-            int numSamplesAtEnd = bufferSize - writeIndex;
-            buffer.copyFrom(channel, writeIndex, data, numSamplesAtEnd);
-
-            // Compute how many samples to write at the beginning
-            int numSamplesAtBeginning = numSamples - numSamplesAtEnd;
-            buffer.copyFrom(channel, 0, data + numSamplesAtEnd, numSamplesAtBeginning);
-        }
-
-        // Update writeIndex
-        writeIndex = (writeIndex + numSamples) % bufferSize;
-    }
-
-    void read(std::vector<float>& output, int numSamples, int channel)
-    {
-        std::lock_guard<std::mutex> lock(bufferMutex);
-
-        assert(!output.empty() && "Output vector must not be empty");
-        assert(numSamples <= bufferSize && "Cannot read more samples than buffer capacity");
-        assert(channel >= 0 && channel < buffer.getNumChannels() && "Invalid channel index");
-
-        // Resize the output vector to the number of samples requested
-        output.resize(numSamples);
-
-        // Compute readIndex to read the most recent samples
-        readIndex = writeIndex - numSamples;
-        if (readIndex < 0) readIndex += bufferSize;
-
-        if (numSamples + readIndex <= bufferSize) // Data fits within a single block
-        {
-            copyBufferToVector(channel, readIndex, numSamples, output, 0);
-        }
-        else
-        {
-            // Data wraps around the buffer
-            int numSamplesAtEnd = bufferSize - readIndex;
-            copyBufferToVector(channel, readIndex, numSamplesAtEnd, output, 0);
-
-            int numSamplesAtBeginning = numSamples - numSamplesAtEnd;
-            copyBufferToVector(channel, 0, numSamplesAtBeginning, output, numSamplesAtEnd);
-        }
-    }
-
-    void clear()
-    {
-        buffer.clear();
-        writeIndex = 0;
-        readIndex = 0;
-    }
-
-private:
-    void copyBufferToVector(int channel, int readIndex, int numSamples, std::vector<float>& output, int startOn)
-    {
-        // Ensure the input parameters are valid
-        assert(channel >= 0 && channel < buffer.getNumChannels());
-        assert(readIndex >= 0 && readIndex + numSamples <= buffer.getNumSamples());
-        assert(startOn >= 0);
-
-        // Get a pointer to the data in the specified channel
-        const float* channelData = buffer.getReadPointer(channel);
-
-        // Copy the data
-        for (int i = 0; i < numSamples; ++i)
-        {
-            output[startOn + i] = channelData[(readIndex + i) % bufferSize];
-        }
-    }
-
-    juce::AudioBuffer<float> buffer; ///< The buffer for storing data.
-    int writeIndex;                  ///< Index where the next data will be written.
-    int readIndex;                   ///< Index where the next data will be read.
-    int bufferSize;                  ///< Capacity of the buffer.
-    std::mutex bufferMutex;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CircularBuffer)
-};
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <algorithm>
+
+/**
+ * CircularBuffer class for managing a ring buffer of audio data.
+ *
+ * Each channel is a wait-free single-producer/single-consumer ring: the audio
+ * thread pushes without ever taking a lock, and a single reader copies the most
+ * recent samples out. The writer publishes its position with release semantics
+ * and announces the region it is about to overwrite beforehand, so the reader
+ * can tell when its copy was torn by a concurrent push and retry.
+ */
+class CircularBuffer
+{
+public:
+    static constexpr int maxReadAttempts = 4; ///< How often a consumer retries a snapshot torn by the producer.
+    static constexpr float silenceThreshold = 1.0e-6f; ///< Samples at or below this magnitude (-120 dBFS) count as silence.
+
+    explicit CircularBuffer(int numChannels, int capacity)
+        : buffer(numChannels, capacity), channelStates(new ChannelState[numChannels]), bufferSize(capacity)
+    {
+        assert(capacity > 0 && "Capacity must be greater than zero");
+        buffer.clear(); // Ensure the buffer starts clean
+    }
+
+    // Producer side: must only ever be called from one thread per channel (the audio thread)
+    void push(const float* data, int numSamples, int channel)
+    {
+        assert(data != nullptr && "Data pointer must not be null");
+        assert(numSamples <= bufferSize && "Cannot push more data at a time than buffer capacity");
+        assert(channel >= 0 && channel < buffer.getNumChannels() && "Invalid channel index");
+
+        auto& state = channelStates[channel];
+        const uint64_t position = state.writePosition.load(std::memory_order_relaxed);
+        const int writeIndex = static_cast<int>(position % static_cast<uint64_t>(bufferSize));
+
+        // Announce the region about to be overwritten before touching any sample
+        state.pendingPosition.store(position + static_cast<uint64_t>(numSamples), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        if (numSamples + writeIndex <= bufferSize) // Data fits completely within buffer
+        {
+            buffer.copyFrom(channel, writeIndex, data, numSamples);
+        }
+        else
+        {
+            // Compute how many samples to write at the end of the buffer
+            int numSamplesAtEnd = bufferSize - writeIndex;
+            buffer.copyFrom(channel, writeIndex, data, numSamplesAtEnd);
+
+            // Compute how many samples to write at the beginning
+            int numSamplesAtBeginning = numSamples - numSamplesAtEnd;
+            buffer.copyFrom(channel, 0, data + numSamplesAtEnd, numSamplesAtBeginning);
+        }
+
+        // Remember where the channel last carried signal, so consumers can tell a silent tail from old audio
+        const juce::Range<float> range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+        if (std::max(-range.getStart(), range.getEnd()) > silenceThreshold)
+            state.signalPosition.store(position + static_cast<uint64_t>(numSamples), std::memory_order_relaxed);
+
+        // Publish the new samples
+        state.writePosition.store(position + static_cast<uint64_t>(numSamples), std::memory_order_release);
+        writeSequence.fetch_add(1, std::memory_order_release);
+    }
+
+    /**
+     * A zero-copy view of the most recent samples of one channel.
+     * The samples are split into two contiguous spans: the head runs up to the end
+     * of the ring, the tail holds whatever wrapped around to its start.
+     */
+    struct Snapshot
+    {
+        const float* head = nullptr; ///< Oldest samples of the view.
+        int headSize = 0;
+        const float* tail = nullptr; ///< Samples that wrapped around to the start of the ring.
+        int tailSize = 0;
+        uint64_t sequence = 0;       ///< Write position the view ends at (total samples pushed).
+        int channel = 0;
+
+        int size() const { return headSize + tailSize; }
+        float operator[](int i) const { return i < headSize ? head[i] : tail[i - headSize]; }
+    };
+
+    // Consumer side: returns a view of the most recent numSamples of the channel without copying.
+    // Fewer samples are returned if the channel has not been written that far yet.
+    // The view may be overwritten by the producer at any time; check isValid() once done with it.
+    Snapshot getSnapshot(int numSamples, int channel) const
+    {
+        return getSnapshotEndingAt(getWritePosition(channel), numSamples, channel);
+    }
+
+    // Consumer side: like getSnapshot(), but for the numSamples that end at an earlier write position.
+    // endPosition must not be ahead of getWritePosition(); if part of the range has already been
+    // overwritten the returned view is shortened to what is still held.
+    Snapshot getSnapshotEndingAt(uint64_t endPosition, int numSamples, int channel) const
+    {
+        assert(numSamples <= bufferSize && "Cannot read more samples than buffer capacity");
+        assert(channel >= 0 && channel < buffer.getNumChannels() && "Invalid channel index");
+
+        Snapshot snapshot;
+        snapshot.channel = channel;
+        snapshot.sequence = endPosition;
+
+        const uint64_t writePosition = getWritePosition(channel);
+        const uint64_t oldestHeld = std::max(channelStates[channel].startPosition,
+                                             writePosition > static_cast<uint64_t>(bufferSize) ? writePosition - bufferSize : 0);
+        uint64_t startPosition = endPosition >= static_cast<uint64_t>(numSamples) ? endPosition - numSamples : 0;
+        startPosition = std::min(std::max(startPosition, oldestHeld), endPosition);
+
+        const int available = static_cast<int>(endPosition - startPosition);
+        const int readIndex = static_cast<int>(startPosition % static_cast<uint64_t>(bufferSize));
+        const float* channelData = buffer.getReadPointer(channel);
+
+        snapshot.head = channelData + readIndex;
+        snapshot.headSize = std::min(available, bufferSize - readIndex);
+        snapshot.tail = channelData;
+        snapshot.tailSize = available - snapshot.headSize;
+
+        return snapshot;
+    }
+
+    // Total number of samples published on a channel so far
+    uint64_t getWritePosition(int channel) const
+    {
+        return channelStates[channel].writePosition.load(std::memory_order_acquire);
+    }
+
+    // Bumped once per push on any channel: consumers compare it with the value they last saw to skip unchanged data
+    uint64_t getWriteSequence() const
+    {
+        return writeSequence.load(std::memory_order_acquire);
+    }
+
+    // Number of most recent samples of the channel that are all silence (at most the total written)
+    uint64_t getSilentSamples(int channel) const
+    {
+        const uint64_t signalPosition = channelStates[channel].signalPosition.load(std::memory_order_relaxed);
+        return getWritePosition(channel) - signalPosition;
+    }
+
+    int getCapacity() const noexcept { return bufferSize; }
+    int getNumChannels() const noexcept { return buffer.getNumChannels(); }
+
+    // True if no sample of the snapshot has been overwritten since it was taken
+    bool isValid(const Snapshot& snapshot) const
+    {
+        return ! wasOverwrittenSince(channelStates[snapshot.channel], snapshot.sequence - static_cast<uint64_t>(snapshot.size()));
+    }
+
+    // Consumer side: copies the numSamples of the channel that end at endPosition into output.
+    // Returns false if some of them were no longer held or got overwritten while copying.
+    bool copyEndingAt(uint64_t endPosition, int numSamples, int channel, float* output) const
+    {
+        const Snapshot snapshot = getSnapshotEndingAt(endPosition, numSamples, channel);
+
+        if (snapshot.size() < numSamples)
+            return false;
+
+        std::copy(snapshot.head, snapshot.head + snapshot.headSize, output);
+        std::copy(snapshot.tail, snapshot.tail + snapshot.tailSize, output + snapshot.headSize);
+        return isValid(snapshot);
+    }
+
+    // Consumer side: copies the most recent numSamples of the channel into output
+    void read(std::vector<float>& output, int numSamples, int channel)
+    {
+        assert(!output.empty() && "Output vector must not be empty");
+        assert(numSamples <= bufferSize && "Cannot read more samples than buffer capacity");
+        assert(channel >= 0 && channel < buffer.getNumChannels() && "Invalid channel index");
+
+        // Resize the output vector to the number of samples requested
+        output.resize(numSamples);
+
+        for (int attempt = 0; attempt < maxReadAttempts; ++attempt)
+        {
+            const Snapshot snapshot = getSnapshot(numSamples, channel);
+            const int startOn = numSamples - snapshot.size();
+
+            // Samples that were never written read as silence
+            std::fill(output.begin(), output.begin() + startOn, 0.0f);
+
+            copySpanToVector(snapshot.head, snapshot.headSize, output, startOn);
+            copySpanToVector(snapshot.tail, snapshot.tailSize, output, startOn + snapshot.headSize);
+
+            if (isValid(snapshot))
+                return;
+        }
+
+        // The writer kept lapping us: the copy holds a mix of old and new blocks,
+        // which is still better for display than blocking the audio thread
+    }
+
+    // Not thread-safe: only call before the ring is shared, to let an empty channel carry on
+    // from another ring's write position. Nothing before position counts as held.
+    void startChannelAt(int channel, uint64_t position)
+    {
+        assert(channel >= 0 && channel < buffer.getNumChannels() && "Invalid channel index");
+        assert(getWritePosition(channel) == 0 && "Only an empty channel can be moved");
+
+        auto& state = channelStates[channel];
+        state.startPosition = position;
+        state.writePosition.store(position, std::memory_order_relaxed);
+        state.pendingPosition.store(position, std::memory_order_relaxed);
+        state.signalPosition.store(position, std::memory_order_relaxed);
+    }
+
+    // Not thread-safe: only call while neither side is running
+    void clear()
+    {
+        buffer.clear();
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            channelStates[channel].startPosition = 0;
+            channelStates[channel].writePosition.store(0, std::memory_order_relaxed);
+            channelStates[channel].pendingPosition.store(0, std::memory_order_relaxed);
+            channelStates[channel].signalPosition.store(0, std::memory_order_relaxed);
+        }
+
+        writeSequence.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) ChannelState
+    {
+        std::atomic<uint64_t> writePosition { 0 };   ///< Total samples published on this channel.
+        std::atomic<uint64_t> pendingPosition { 0 }; ///< End of the region the writer is currently filling.
+        std::atomic<uint64_t> signalPosition { 0 };  ///< Write position at the end of the last push that was not silent.
+        uint64_t startPosition = 0;                  ///< First position the ring holds; only set before the ring is shared.
+    };
+
+    // True if any sample at or after startPosition may have been overwritten while we were copying
+    bool wasOverwrittenSince(const ChannelState& state, uint64_t startPosition) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return state.pendingPosition.load(std::memory_order_relaxed) > startPosition + static_cast<uint64_t>(bufferSize);
+    }
+
+    static void copySpanToVector(const float* source, int numSamples, std::vector<float>& output, int startOn)
+    {
+        assert(startOn >= 0 && startOn + numSamples <= static_cast<int>(output.size()));
+
+        if (numSamples > 0)
+            juce::FloatVectorOperations::copy(output.data() + startOn, source, numSamples);
+    }
+
+    juce::AudioBuffer<float> buffer;                  ///< The buffer for storing data.
+    std::unique_ptr<ChannelState[]> channelStates;    ///< Per-channel write positions shared between threads.
+    int bufferSize;                                   ///< Capacity of the buffer.
+    std::atomic<uint64_t> writeSequence { 0 };        ///< Number of pushes so far, over all channels.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CircularBuffer)
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "StftAnalyzer.h"
+#include "HalfBandDecimator.h"
+#include "SpectrumBinMap.h"
+
+/**
+ * ConstantQAnalyzer class: a multi-rate, octave-by-octave spectrum estimate.
+ * New samples of the capture ring run through a cascade of half-band decimators, so octave k
+ * sees the signal at sampleRate / 2^k. Every octave keeps its own ring and runs a small,
+ * fixed-size StftAnalyzer on it, and each display column is read from the octave whose
+ * alias-free band holds its frequency. Bins are therefore 2^k times narrower in octave k and
+ * the resolution stays roughly proportional to frequency (constant Q), while the cost is about
+ * twice that of the top octave alone instead of one transform long enough for the lowest one.
+ *
+ * Octave 0 serves [0.2, 0.5] * sampleRate, octave k > 0 serves [0.2, 0.4] of its own rate and
+ * the last octave also everything below.
+ */
+class ConstantQAnalyzer
+{
+public:
+    static constexpr int frameOrder = 8;                 ///< Every octave transforms 256-point frames...
+    static constexpr int hopSize = 64;                   ///< ...every 64 samples at its own rate.
+    static constexpr int maxInputBlock = 1024;           ///< Ring samples fed through the cascade at a time.
+    static constexpr double lowestFrequency = 20.0;      ///< Octaves are added until their band reaches down to this.
+
+    struct Config
+    {
+        int sampleRate = 0;
+        double averagingSeconds = 0.5; // Length of the Welch average in every octave
+        WindowType window = WindowType::hann;
+        int channel = 0;
+
+        bool operator==(const Config& other) const
+        {
+            return sampleRate == other.sampleRate && averagingSeconds == other.averagingSeconds
+                && window == other.window && channel == other.channel;
+        }
+
+        bool operator!=(const Config& other) const { return ! (*this == other); }
+    };
+
+    ConstantQAnalyzer() = default;
+
+    // Applies a new configuration; every octave restarts if anything changed
+    void configure(const Config& newConfig)
+    {
+        if (newConfig == config && ! octaves.empty())
+            return;
+
+        config = newConfig;
+        octaves.clear();
+        octaveMagnitudes.clear();
+        columnMapSize = 0;
+        hasReadPosition = false;
+
+        if (config.sampleRate <= 0)
+            return;
+
+        const int numOctaves = getNumOctaves(config.sampleRate);
+
+        for (int k = 0; k < numOctaves; ++k)
+        {
+            const double rate = (double)config.sampleRate / (1 << k);
+
+            StftAnalyzer::Config stftConfig;
+            stftConfig.frameOrder = frameOrder;
+            stftConfig.hopSize = hopSize;
+            stftConfig.window = config.window;
+            stftConfig.numFramesAveraged = getNumFramesAveraged(config, k);
+            stftConfig.channel = 0;
+
+            const int capacity = (1 << frameOrder) + hopSize * (stftConfig.numFramesAveraged - 1) + maxInputBlock;
+            octaves.push_back(std::make_unique<Octave>(rate, capacity, k == 0 ? 0 : juce::jmax(1, maxInputBlock >> (k - 1))));
+            octaves.back()->stft.configure(stftConfig);
+            octaveMagnitudes.push_back(octaves.back()->magnitudes.data());
+        }
+    }
+
+    // Feeds everything the capture ring received since the last call through the cascade and
+    // transforms the frames that completed. If the ring overwrote samples before they were read,
+    // the cascade carries on from what is still held.
+    void process(const CircularBuffer& buffer, FFTEngine& fftEngine)
+    {
+        if (octaves.empty())
+            return;
+
+        const uint64_t writePosition = buffer.getWritePosition(config.channel);
+        const uint64_t capacity = (uint64_t)buffer.getCapacity();
+
+        if (! hasReadPosition || readPosition > writePosition || writePosition - readPosition > capacity)
+        {
+            readPosition = writePosition - std::min(writePosition, capacity);
+            hasReadPosition = true;
+        }
+
+        while (readPosition < writePosition)
+        {
+            const int numSamples = (int)std::min<uint64_t>(maxInputBlock, writePosition - readPosition);
+
+            if (buffer.copyEndingAt(readPosition + (uint64_t)numSamples, numSamples, config.channel, inputBlock))
+                feed(inputBlock, numSamples);
+
+            readPosition += (uint64_t)numSamples;
+        }
+
+        for (auto& octave : octaves)
+            octave->stft.process(octave->ring, fftEngine);
+    }
+
+    // Writes the magnitude at each of numColumns log-spaced display columns, laid out like
+    // SpectrumBinMap for an FFT of axisFFTSize at the configured sample rate, on the scale of
+    // an unwindowed transform of frameSize points
+    void getColumns(int axisFFTSize, int numColumns, float* columnValues)
+    {
+        if (octaves.empty())
+        {
+            juce::FloatVectorOperations::clear(columnValues, numColumns);
+            return;
+        }
+
+        prepareColumns(axisFFTSize, numColumns);
+
+        for (auto& octave : octaves)
+            octave->stft.getMagnitudes(octave->magnitudes.data());
+
+        binMap.reduce(octaveMagnitudes.data(), columnValues, SpectrumBinMap::Reduction::peak);
+    }
+
+    static constexpr int getFrameSize() { return 1 << frameOrder; }
+    int getNumOctaves() const noexcept { return (int)octaves.size(); }
+
+    static int getNumOctaves(int sampleRate)
+    {
+        return juce::jmax(1, (int)std::ceil(std::log2(0.2 * sampleRate / lowestFrequency)) + 1);
+    }
+
+    // Input samples that still affect the estimate: the span of the lowest octave's averaged frames
+    static uint64_t getSpanSamples(const Config& config)
+    {
+        if (config.sampleRate <= 0)
+            return 0;
+
+        const int lowest = getNumOctaves(config.sampleRate) - 1;
+        const uint64_t span = (uint64_t)getFrameSize() + (uint64_t)hopSize * (getNumFramesAveraged(config, lowest) - 1);
+        return (span + 2 * (uint64_t)HalfBandDecimator::getLatency()) << lowest; // Latencies of the cascade add up to under twice the last one
+    }
+
+private:
+    struct Octave
+    {
+        // decimatorInput = 0 for the top octave, which reads the ring at full rate
+        Octave(double _rate, int capacity, int decimatorInput)
+            : rate(_rate), ring(1, capacity), magnitudes(static_cast<size_t>(getFrameSize() / 2), 0.0f)
+        {
+            if (decimatorInput > 0)
+            {
+                decimator = std::make_unique<HalfBandDecimator>(decimatorInput);
+                output.resize(static_cast<size_t>(decimatorInput / 2 + 1));
+            }
+        }
+
+        double rate;
+        CircularBuffer ring;                          ///< This octave's signal at its own rate.
+        StftAnalyzer stft;
+        std::unique_ptr<HalfBandDecimator> decimator; ///< From the octave above; null for octave 0.
+        std::vector<float> output;                    ///< Decimator output, one block.
+        std::vector<float> magnitudes;
+    };
+
+    static int getNumFramesAveraged(const Config& config, int octave)
+    {
+        return juce::jmax(1, (int)(config.sampleRate * config.averagingSeconds) / (hopSize << octave));
+    }
+
+    void feed(const float* samples, int numSamples)
+    {
+        octaves[0]->ring.push(samples, numSamples, 0);
+
+        for (size_t k = 1; k < octaves.size() && numSamples > 0; ++k)
+        {
+            Octave& octave = *octaves[k];
+            numSamples = octave.decimator->process(samples, numSamples, octave.output.data());
+            samples = octave.output.data();
+
+            if (numSamples > 0)
+                octave.ring.push(samples, numSamples, 0);
+        }
+    }
+
+    // Octave whose alias-free band holds the frequency: the highest one for which it is at least 0.2 of the rate
+    int getOctaveFor(double frequency) const
+    {
+        int k = 0;
+        while (k + 1 < (int)octaves.size() && frequency < 0.2 * octaves[k]->rate)
+            ++k;
+
+        return k;
+    }
+
+    // Rebuilds the column map if the layout changed. Column c covers the frequencies of bins
+    // exp(log(axisFFTSize) * c / numColumns) - 1 to the same at c + 1 of the axis FFT, read from
+    // the octave that holds its centre; columns past the last bin of the axis stay empty.
+    void prepareColumns(int axisFFTSize, int numColumns)
+    {
+        if (axisFFTSize == columnMapSize && numColumns == binMap.getNumColumns())
+            return;
+
+        columnMapSize = axisFFTSize;
+
+        const double logSize = std::log((double)axisFFTSize);
+        const double hertzPerAxisBin = (double)config.sampleRate / axisFFTSize;
+        const int numColumnsWithBins = SpectrumBinMap::getNumColumnsWithBins(axisFFTSize, numColumns);
+
+        binMap.build(numColumns, getFrameSize() / 2, [&](int c)
+        {
+            const double centre = (std::exp(logSize * (c + 0.5) / numColumns) - 1.0) * hertzPerAxisBin;
+            const int octave = getOctaveFor(centre);
+            const double hertzPerBin = octaves[octave]->rate / getFrameSize();
+
+            SpectrumBinMap::ColumnSpan span;
+            span.low = (std::exp(logSize * c / numColumns) - 1.0) * hertzPerAxisBin / hertzPerBin;
+            span.high = (std::exp(logSize * (c + 1) / numColumns) - 1.0) * hertzPerAxisBin / hertzPerBin;
+            span.centre = centre / hertzPerBin;
+            span.source = c < numColumnsWithBins ? octave : SpectrumBinMap::noSource;
+            return span;
+        });
+    }
+
+    Config config;
+    std::vector<std::unique_ptr<Octave>> octaves;
+    std::vector<const float*> octaveMagnitudes; ///< Octave k's magnitudes, the sources of binMap.
+    SpectrumBinMap binMap;             ///< Columns of the log axis, each mapped onto the bins of one octave.
+    int columnMapSize = 0;             ///< Axis FFT size the column map was built for, 0 if none.
+
+    float inputBlock[maxInputBlock];   ///< Samples copied out of the capture ring.
+    uint64_t readPosition = 0;         ///< Capture ring position fed through the cascade so far.
+    bool hasReadPosition = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConstantQAnalyzer)
+};
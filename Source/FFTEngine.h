@@ -0,0 +1,281 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cmath>
+#include "AlignedBuffer.h"
+#include "SpectrumKernels.h"
+#include "RealtimeChecks.h"
+
+// FFT backend selection. Override from the Projucer's preprocessor definitions,
+// e.g. SPECTRUM_FFT_BACKEND=SPECTRUM_FFT_BACKEND_JUCE
+#define SPECTRUM_FFT_BACKEND_JUCE 0    // juce::dsp::FFT (picks up vDSP/IPP/FFTW when JUCE is configured for them)
+#define SPECTRUM_FFT_BACKEND_BUNDLED 1 // Self-contained radix-2 real-input FFT below
+
+#ifndef SPECTRUM_FFT_BACKEND
+ #define SPECTRUM_FFT_BACKEND SPECTRUM_FFT_BACKEND_BUNDLED
+#endif
+
+/**
+ * FFTPlan holds everything needed to transform one power-of-two size.
+ * A plan is immutable once built, so a single plan can be used from several threads
+ * as long as each one works on its own buffer.
+ *
+ * The real-input transform works on a buffer of 2 * N floats whose first N entries hold
+ * the samples. On return the first N + 2 entries hold bins 0..N/2 as interleaved
+ * (real, imaginary) pairs.
+ *
+ * The complex transform moves the same amount of data: N/2 interleaved complex points,
+ * N floats, in natural bin order.
+ */
+class FFTPlan
+{
+public:
+    explicit FFTPlan(int _order)
+        : order(_order), size(1 << _order)
+    {
+        assert(order >= 2 && "FFT plans need at least four points");
+
+       #if SPECTRUM_FFT_BACKEND == SPECTRUM_FFT_BACKEND_JUCE
+        fft = std::make_unique<juce::dsp::FFT>(order);
+        complexFft = std::make_unique<juce::dsp::FFT>(order - 1);
+       #else
+        const int halfSize = size / 2;
+
+        // Twiddles for the N/2-point complex transform: e^(-2*pi*i*j / (N/2))
+        complexTwiddles.resize(static_cast<size_t>(halfSize));
+        for (int j = 0; j < halfSize / 2; ++j)
+        {
+            const double angle = -2.0 * juce::MathConstants<double>::pi * j / halfSize;
+            complexTwiddles[2 * j] = static_cast<float>(std::cos(angle));
+            complexTwiddles[2 * j + 1] = static_cast<float>(std::sin(angle));
+        }
+
+        // Post-twiddles that split the packed even/odd spectrum into the real-input spectrum: e^(-2*pi*i*k / N)
+        realTwiddles.resize(static_cast<size_t>(halfSize + 2));
+        for (int k = 0; k <= halfSize / 2; ++k)
+        {
+            const double angle = -2.0 * juce::MathConstants<double>::pi * k / size;
+            realTwiddles[2 * k] = static_cast<float>(std::cos(angle));
+            realTwiddles[2 * k + 1] = static_cast<float>(std::sin(angle));
+        }
+
+        // Bit-reversal permutation of the complex transform, stored as swap pairs
+        const int halfOrder = order - 1;
+        for (int i = 0; i < halfSize; ++i)
+        {
+            int reversed = 0;
+            for (int bit = 0; bit < halfOrder; ++bit)
+                reversed |= ((i >> bit) & 1) << (halfOrder - 1 - bit);
+
+            if (i < reversed)
+            {
+                swapPairs.push_back(i);
+                swapPairs.push_back(reversed);
+            }
+        }
+       #endif
+    }
+
+    int getOrder() const noexcept { return order; }
+    int getSize() const noexcept { return size; }
+
+    void performRealForward(float* data) const
+    {
+       #if SPECTRUM_FFT_BACKEND == SPECTRUM_FFT_BACKEND_JUCE
+        fft->performRealOnlyForwardTransform(data, true);
+       #else
+        // Treat the N real samples as N/2 complex ones (even samples real, odd samples imaginary)
+        performComplexInPlace(data, size / 2);
+        splitRealSpectrum(data);
+       #endif
+    }
+
+    // Forward transform of N/2 interleaved complex points. input and output must not overlap:
+    // juce::dsp::FFT cannot transform complex data in place.
+    void performComplexForward(const float* input, float* output) const
+    {
+       #if SPECTRUM_FFT_BACKEND == SPECTRUM_FFT_BACKEND_JUCE
+        jassert(input != output && "juce::dsp::FFT transforms complex data out of place only");
+        complexFft->perform(reinterpret_cast<const juce::dsp::Complex<float>*>(input),
+                            reinterpret_cast<juce::dsp::Complex<float>*>(output), false);
+       #else
+        if (input != output)
+            std::copy(input, input + size, output);
+
+        performComplexInPlace(output, size / 2);
+       #endif
+    }
+
+private:
+   #if SPECTRUM_FFT_BACKEND == SPECTRUM_FFT_BACKEND_BUNDLED
+    // Iterative radix-2 decimation-in-time transform of numPoints interleaved complex values
+    void performComplexInPlace(float* data, int numPoints) const
+    {
+        for (size_t i = 0; i < swapPairs.size(); i += 2)
+        {
+            const int a = 2 * swapPairs[i];
+            const int b = 2 * swapPairs[i + 1];
+            std::swap(data[a], data[b]);
+            std::swap(data[a + 1], data[b + 1]);
+        }
+
+        for (int length = 2; length <= numPoints; length <<= 1)
+        {
+            const int half = length / 2;
+            const int twiddleStep = numPoints / length;
+
+            for (int start = 0; start < numPoints; start += length)
+            {
+                float* even = data + 2 * start;
+                float* odd = even + 2 * half;
+
+                for (int j = 0; j < half; ++j)
+                {
+                    const float wr = complexTwiddles[2 * j * twiddleStep];
+                    const float wi = complexTwiddles[2 * j * twiddleStep + 1];
+
+                    const float vr = odd[2 * j] * wr - odd[2 * j + 1] * wi;
+                    const float vi = odd[2 * j] * wi + odd[2 * j + 1] * wr;
+
+                    odd[2 * j] = even[2 * j] - vr;
+                    odd[2 * j + 1] = even[2 * j + 1] - vi;
+                    even[2 * j] += vr;
+                    even[2 * j + 1] += vi;
+                }
+            }
+        }
+    }
+
+    // Post-twiddle: X[k] = E[k] + W^k * O[k], with E/O recovered from Z[k] and conj(Z[N/2 - k])
+    void splitRealSpectrum(float* data) const
+    {
+        const int halfSize = size / 2;
+
+        const float dc = data[0] + data[1];
+        const float nyquist = data[0] - data[1];
+
+        for (int k = 1; k <= halfSize / 2; ++k)
+        {
+            const int mirror = halfSize - k;
+
+            const float zr = data[2 * k], zi = data[2 * k + 1];
+            const float mr = data[2 * mirror], mi = -data[2 * mirror + 1];
+
+            const float er = 0.5f * (zr + mr), ei = 0.5f * (zi + mi);
+            const float or_ = 0.5f * (zi - mi), oi = -0.5f * (zr - mr);
+
+            const float wr = realTwiddles[2 * k], wi = realTwiddles[2 * k + 1];
+            const float tr = or_ * wr - oi * wi;
+            const float ti = or_ * wi + oi * wr;
+
+            data[2 * k] = er + tr;
+            data[2 * k + 1] = ei + ti;
+            data[2 * mirror] = er - tr;
+            data[2 * mirror + 1] = -(ei - ti);
+        }
+
+        data[0] = dc;
+        data[1] = 0.0f;
+        data[2 * halfSize] = nyquist;
+        data[2 * halfSize + 1] = 0.0f;
+    }
+
+    std::vector<float> complexTwiddles; ///< Interleaved twiddles of the N/2-point complex stage.
+    std::vector<float> realTwiddles;    ///< Interleaved post-twiddles for bins 0..N/4.
+    std::vector<int> swapPairs;         ///< Bit-reversal permutation as (i, j) swap pairs.
+   #else
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::unique_ptr<juce::dsp::FFT> complexFft; ///< N/2 points, for performComplexForward().
+   #endif
+
+    int order;
+    int size;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FFTPlan)
+};
+
+/**
+ * FFTPlanCache: the plans of every FFTEngine in the process, one per power-of-two size.
+ * Hold it through a juce::SharedResourcePointer<FFTPlanCache>, so plugin instances analysing
+ * at the same size share one set of twiddle and bit-reversal tables. Plans are built on first
+ * request and never removed while the cache lives; the lock is only taken on that first request.
+ */
+class FFTPlanCache
+{
+public:
+    static constexpr int maxOrder = 24;
+
+    FFTPlanCache() = default;
+
+    // Any thread. The returned plan stays valid for the lifetime of the cache.
+    const FFTPlan& getPlan(int order)
+    {
+        assert(order >= 0 && order <= maxOrder && "FFT order out of range");
+
+        const RealtimeChecks::ScopedCheckedLock lock(plansLock);
+
+        if (plans[order] == nullptr)
+            plans[order] = std::make_unique<FFTPlan>(order);
+
+        return *plans[order];
+    }
+
+private:
+    juce::CriticalSection plansLock;
+    std::unique_ptr<FFTPlan> plans[maxOrder + 1]; ///< Lazily built plans, indexed by order.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FFTPlanCache)
+};
+
+/**
+ * FFTEngine transforms through the process-wide plan cache and owns a reusable aligned workspace,
+ * so repeated transforms of the same size allocate nothing and take no lock.
+ * Usage: fill getInputBuffer(order) with N samples, then call computeMagnitudes().
+ */
+class FFTEngine
+{
+public:
+    static constexpr int minOrder = 2;
+    static constexpr int maxOrder = FFTPlanCache::maxOrder;
+
+    FFTEngine() = default;
+
+    // Returns the plan for a size of 2^order, fetching it from the shared cache on first use
+    const FFTPlan& getPlan(int order)
+    {
+        assert(order >= minOrder && order <= maxOrder && "FFT order out of range");
+
+        if (plans[order] == nullptr)
+            plans[order] = &sharedPlans->getPlan(order);
+
+        return *plans[order];
+    }
+
+    // Returns the workspace to write 2^order real input samples into
+    float* getInputBuffer(int order)
+    {
+        workspace.ensureSize(2 << order);
+        return workspace.get();
+    }
+
+    // Transforms the workspace in place and writes the 2^(order-1) positive-frequency magnitudes
+    void computeMagnitudes(int order, float* magnitudes)
+    {
+        const FFTPlan& plan = getPlan(order);
+        float* data = getInputBuffer(order);
+
+        plan.performRealForward(data);
+
+        SpectrumKernels::magnitudeInterleaved(data, magnitudes, plan.getSize() / 2);
+    }
+
+private:
+    juce::SharedResourcePointer<FFTPlanCache> sharedPlans;
+    const FFTPlan* plans[maxOrder + 1] = {};      ///< Plans fetched so far, indexed by order; owned by sharedPlans.
+    AlignedBuffer<float> workspace;               ///< In-place transform buffer, 2 * N floats.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FFTEngine)
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+#include "AlignedBuffer.h"
+
+/**
+ * FilterBank class: a multi-channel low-pass that runs every channel in its own SIMD lane.
+ * Channels are interleaved into juce::dsp::SIMDRegister lanes, filtered with topology-preserving
+ * transform (TPT) stages and de-interleaved again: a one-pole for 6 dB/oct, one state-variable
+ * stage for 12 dB/oct, two Butterworth-tuned stages for 24 dB/oct.
+ *
+ * Cutoff and slope can be set from any thread; the audio thread picks them up through atomics,
+ * smooths the cutoff per sample and only recomputes coefficients while it is actually moving.
+ */
+class FilterBank
+{
+public:
+    enum class Slope
+    {
+        db6 = 0,
+        db12,
+        db24
+    };
+
+    FilterBank() = default;
+
+    // Not real-time safe: sizes the interleaving scratch for the largest expected block
+    void prepare(double _sampleRate, int maxBlockSize, int _numChannels)
+    {
+        sampleRate = _sampleRate;
+        numChannels = juce::jmax(1, _numChannels);
+        numGroups = (numChannels + (int)Register::size() - 1) / (int)Register::size();
+        jassert(numGroups <= maxGroups && "Too many channels for the filter bank");
+        numGroups = juce::jmin(numGroups, maxGroups);
+        numChannels = juce::jmin(numChannels, numGroups * (int)Register::size());
+        scratchSamples = juce::jmax(1, maxBlockSize);
+        scratch.ensureSize(scratchSamples * numGroups * (int)Register::size());
+        scratch.clear(scratchSamples * numGroups * (int)Register::size());
+
+        cutoff.reset(sampleRate, smoothingSeconds);
+        cutoff.setCurrentAndTargetValue(limitCutoff(targetCutoff.load(std::memory_order_relaxed)));
+        updateCoefficients(cutoff.getCurrentValue());
+        reset();
+    }
+
+    void reset()
+    {
+        for (int group = 0; group < maxGroups; ++group)
+            for (auto& state : states[group])
+                state = Register(0.0f);
+    }
+
+    // Any thread: lock-free handoff to the audio thread
+    void setCutoff(float frequency) { targetCutoff.store(frequency, std::memory_order_relaxed); }
+    void setSlope(Slope slope) { targetSlope.store(slope, std::memory_order_relaxed); }
+
+    // Audio thread: filters the first numChannels channels of the buffer in place
+    void process(juce::AudioBuffer<float>& buffer, int _numChannels, int numSamples)
+    {
+        jassert(_numChannels <= numChannels && "More channels than prepared for");
+        _numChannels = juce::jmin(_numChannels, numChannels);
+
+        const Slope requestedSlope = targetSlope.load(std::memory_order_relaxed);
+        if (requestedSlope != slope)
+        {
+            slope = requestedSlope;
+            updateCoefficients(cutoff.getCurrentValue());
+            reset();
+        }
+
+        cutoff.setTargetValue(limitCutoff(targetCutoff.load(std::memory_order_relaxed)));
+
+        for (int start = 0; start < numSamples; start += scratchSamples)
+        {
+            const int count = juce::jmin(scratchSamples, numSamples - start);
+            interleave(buffer, _numChannels, start, count);
+            filterInterleaved(count);
+            deinterleave(buffer, _numChannels, start, count);
+        }
+    }
+
+private:
+    using Register = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int maxGroups = 8;           // Up to 8 * lane-count channels
+    static constexpr double smoothingSeconds = 0.05;
+
+    // State registers per lane group: one-pole state, then (ic1, ic2) per SVF stage
+    enum StateIndex { onePole = 0, stage1ic1, stage1ic2, stage2ic1, stage2ic2, numStates };
+
+    struct Coefficients
+    {
+        float onePoleGain = 0.0f;           // G = g / (1 + g)
+        float a1[2] = {}, a2[2] = {}, a3[2] = {}; // Per SVF stage
+    };
+
+    float limitCutoff(float frequency) const
+    {
+        return juce::jlimit(10.0f, (float)(0.49 * sampleRate), frequency);
+    }
+
+    void updateCoefficients(float frequency)
+    {
+        const double g = std::tan(juce::MathConstants<double>::pi * frequency / sampleRate);
+        coefficients.onePoleGain = (float)(g / (1.0 + g));
+
+        // 12 dB/oct uses Q = 1/sqrt(2); 24 dB/oct cascades the two Butterworth fourth-order sections
+        const double q12[2] = { 0.70710678, 0.70710678 };
+        const double q24[2] = { 0.54119610, 1.30656296 };
+        const double* q = slope == Slope::db24 ? q24 : q12;
+
+        for (int stage = 0; stage < 2; ++stage)
+        {
+            const double k = 1.0 / q[stage];
+            const double a1 = 1.0 / (1.0 + g * (g + k));
+            coefficients.a1[stage] = (float)a1;
+            coefficients.a2[stage] = (float)(g * a1);
+            coefficients.a3[stage] = (float)(g * g * a1);
+        }
+    }
+
+    void interleave(const juce::AudioBuffer<float>& buffer, int channels, int start, int count)
+    {
+        const int stride = numGroups * (int)Register::size();
+        float* data = scratch.get();
+
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            const float* source = buffer.getReadPointer(channel, start);
+            for (int i = 0; i < count; ++i)
+                data[i * stride + channel] = source[i];
+        }
+    }
+
+    void deinterleave(juce::AudioBuffer<float>& buffer, int channels, int start, int count) const
+    {
+        const int stride = numGroups * (int)Register::size();
+        const float* data = scratch.get();
+
+        for (int channel = 0; channel < channels; ++channel)
+        {
+            float* destination = buffer.getWritePointer(channel, start);
+            for (int i = 0; i < count; ++i)
+                destination[i] = data[i * stride + channel];
+        }
+    }
+
+    void filterInterleaved(int count)
+    {
+        float* data = scratch.get();
+        const int numStages = slope == Slope::db24 ? 2 : 1;
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (cutoff.isSmoothing())
+                updateCoefficients(cutoff.getNextValue());
+
+            for (int group = 0; group < numGroups; ++group)
+            {
+                float* frame = data + (i * numGroups + group) * (int)Register::size();
+                Register* state = states[group];
+                Register x = Register::fromRawArray(frame);
+
+                if (slope == Slope::db6)
+                {
+                    // TPT one-pole: v = (x - s) G, y = v + s, s = y + v
+                    const Register v = (x - state[onePole]) * Register(coefficients.onePoleGain);
+                    x = v + state[onePole];
+                    state[onePole] = x + v;
+                }
+                else
+                {
+                    for (int stage = 0; stage < numStages; ++stage)
+                    {
+                        // TPT state-variable filter, low-pass output
+                        Register& ic1 = state[stage1ic1 + 2 * stage];
+                        Register& ic2 = state[stage1ic2 + 2 * stage];
+
+                        const Register v3 = x - ic2;
+                        const Register v1 = Register(coefficients.a1[stage]) * ic1 + Register(coefficients.a2[stage]) * v3;
+                        const Register v2 = ic2 + Register(coefficients.a2[stage]) * ic1 + Register(coefficients.a3[stage]) * v3;
+
+                        ic1 = Register(2.0f) * v1 - ic1;
+                        ic2 = Register(2.0f) * v2 - ic2;
+                        x = v2;
+                    }
+                }
+
+                x.copyToRawArray(frame);
+            }
+        }
+    }
+
+    AlignedBuffer<float> scratch;    ///< Interleaved samples: [sample][group][lane].
+    Register states[maxGroups][numStates];
+    Coefficients coefficients;
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> cutoff;
+
+    std::atomic<float> targetCutoff { 20000.0f };
+    std::atomic<Slope> targetSlope { Slope::db6 };
+    Slope slope = Slope::db6;
+
+    double sampleRate = 44100.0;
+    int numChannels = 1;
+    int numGroups = 1;
+    int scratchSamples = 1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FilterBank)
+};
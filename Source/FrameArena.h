@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "AlignedBuffer.h"
+
+/**
+ * FrameArena class: bump-pointer scratch memory for one display frame.
+ * Every allocation is aligned to a cache line and lives until the next reset(), which the
+ * owner calls at the start of each frame; nothing is freed individually. A frame that asks
+ * for more than the arena holds is served from overflow blocks, and the next reset() merges
+ * them into one block big enough for that frame, so once the frame sizes settle the arena
+ * stops touching the heap.
+ */
+class FrameArena
+{
+public:
+    static constexpr size_t alignment = 64;
+
+    explicit FrameArena(int _capacityBytes = 0)
+    {
+        block.ensureSize(_capacityBytes);
+    }
+
+    // Releases everything allocated since the last reset; grows first if the last frame overflowed
+    void reset()
+    {
+        if (! overflow.empty())
+        {
+            block.ensureSize((int)highWaterMark);
+            overflow.clear();
+        }
+
+        used = 0;
+        highWaterMark = 0;
+    }
+
+    // Uninitialised, 64-byte aligned space for numElements values, valid until the next reset()
+    template <typename T>
+    T* allocate(int numElements)
+    {
+        assert(numElements >= 0 && "Size must not be negative");
+
+        const size_t bytes = roundUp(static_cast<size_t>(numElements) * sizeof(T));
+        highWaterMark += bytes;
+
+        if (used + bytes <= static_cast<size_t>(block.getCapacity()))
+        {
+            char* start = block.get() + used;
+            used += bytes;
+            return reinterpret_cast<T*>(start);
+        }
+
+        // Out of space this frame: reset() will make the block big enough for next time
+        overflow.push_back(std::make_unique<AlignedBuffer<char, alignment>>((int)bytes));
+        return reinterpret_cast<T*>(overflow.back()->get());
+    }
+
+    int getCapacity() const noexcept { return block.getCapacity(); }
+
+private:
+    static size_t roundUp(size_t bytes) noexcept
+    {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    AlignedBuffer<char, alignment> block;
+    size_t used = 0;                ///< Bytes handed out from block this frame.
+    size_t highWaterMark = 0;       ///< Bytes requested this frame, overflow included.
+    std::vector<std::unique_ptr<AlignedBuffer<char, alignment>>> overflow;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FrameArena)
+};
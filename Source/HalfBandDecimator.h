@@ -0,0 +1,114 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * HalfBandDecimator class: a streaming low-pass and downsample by two.
+ * The filter is a Kaiser-windowed half-band FIR, flat to passbandEdge and at least 80 dB down
+ * from 1 - passbandEdge (both as fractions of the output rate), so everything below
+ * passbandEdge * outputRate survives decimation without aliases. Every other tap of a half-band
+ * filter is zero and the rest are symmetric, so one output costs numPairs multiplies plus one.
+ * Blocks of any length, odd ones included, can be pushed one after another.
+ */
+class HalfBandDecimator
+{
+public:
+    static constexpr int numPairs = 14;                  ///< Non-zero taps on each side of the centre tap.
+    static constexpr int numTaps = 4 * numPairs - 1;     ///< 55 taps.
+    static constexpr double passbandEdge = 0.4;          ///< Alias-free band, as a fraction of the output rate.
+
+    explicit HalfBandDecimator(int _maxInputSize)
+        : maxInputSize(_maxInputSize), work(static_cast<size_t>(numTaps - 1 + _maxInputSize), 0.0f)
+    {
+        assert(maxInputSize > 0);
+        designTaps();
+    }
+
+    void reset()
+    {
+        std::fill(work.begin(), work.end(), 0.0f);
+        skip = 0;
+    }
+
+    // Filters numInput samples and writes every second one to output, which must hold numInput / 2 + 1
+    // and may be the input itself. Returns the number of samples written.
+    int process(const float* input, int numInput, float* output)
+    {
+        assert(numInput <= maxInputSize && "Input block larger than the decimator was built for");
+
+        // work = the last numTaps - 1 inputs, then this block
+        std::copy(input, input + numInput, work.begin() + (numTaps - 1));
+
+        int numOutput = 0;
+        for (int i = skip; i < numInput; i += 2)
+        {
+            // Filter window ending at input[i]
+            const float* x = work.data() + i;
+            float sum = centreTap * x[centre];
+
+            for (int j = 0; j < numPairs; ++j)
+                sum += pairTaps[j] * (x[centre - 1 - 2 * j] + x[centre + 1 + 2 * j]);
+
+            output[numOutput++] = sum;
+        }
+
+        // Where the next output falls relative to the next block, and the history it needs
+        skip = skip + 2 * numOutput - numInput;
+        std::copy(work.begin() + numInput, work.begin() + numInput + (numTaps - 1), work.begin());
+
+        return numOutput;
+    }
+
+    // Delay of the filter, in input samples
+    static constexpr int getLatency() { return centre; }
+
+private:
+    static constexpr int centre = numTaps / 2;
+
+    // Windowed sinc at half the input Nyquist, normalised to unity gain at DC
+    void designTaps()
+    {
+        const double beta = 0.1102 * (80.0 - 8.7); // Kaiser's formula for 80 dB stopband attenuation
+        const double pi = juce::MathConstants<double>::pi;
+
+        double taps[numPairs];
+        double sum = 0.5;
+
+        for (int j = 0; j < numPairs; ++j)
+        {
+            const int offset = 1 + 2 * j;
+            const double ratio = (double)offset / centre;
+            const double window = besselI0(beta * std::sqrt(1.0 - ratio * ratio)) / besselI0(beta);
+            taps[j] = std::sin(0.5 * pi * offset) / (pi * offset) * window;
+            sum += 2.0 * taps[j];
+        }
+
+        centreTap = (float)(0.5 / sum);
+        for (int j = 0; j < numPairs; ++j)
+            pairTaps[j] = (float)(taps[j] / sum);
+    }
+
+    static double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+        for (int k = 1; k < 32; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    const int maxInputSize;
+    std::vector<float> work;     ///< Filter history followed by the current block.
+    float centreTap = 0.5f;
+    float pairTaps[numPairs];    ///< Taps at centre +- 1, +- 3, ...
+    int skip = 0;                ///< Index of the next output within the next block (0 or 1).
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(HalfBandDecimator)
+};
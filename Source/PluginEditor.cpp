@@ -1,192 +1,407 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-#define PADDING 8 //absolute no pixels
-#define ITEM_SIZE 100 //absolute no pixels
-#define BUTTON_HEIGHT 20 //absolute no pixels
-#define BUTTON_WIDTH 60 //absolute no pixels
-#define VISUALIZER_WIDTH 800 //absolute no pixels
-#define VISUALIZER_HEIGHT 150 //absolute no pixels
-#define VISUAL_FRAMERATE 30 //in hertz
-#define SPECTRUM_HEIGHT 250 //absolute no pixels
-#define SPECTRUM_WIDTH 200 //absolute no pixels
-
-//==============================================================================
-SpectrumAnalyzerAudioProcessorEditor::SpectrumAnalyzerAudioProcessorEditor (SpectrumAnalyzerAudioProcessor& p)
-    : AudioProcessorEditor (&p), audioProcessor (p)
-{
-    // Make sure that before the constructor has finished, you've set the
-    // editor's size to whatever you need it to be.
-    setSize (400, 300);
-
-    // Enable resizing
-    setResizable(true, true);
-
-    // Set minimum and maximum size (minWidth, minHeight, maxWidth, maxHeight)
-    setResizeLimits(600, 400, 1000, 800);
-
-    // Configure the knob's properties
-    knob.setSliderStyle(juce::Slider::Rotary);
-    knob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
-    knob.setRange(0.1, 10, 0.01); // Min, Max, Step size
-    knob.setValue(0.5); // Default value
-
-
-    lowPassKnob.setSliderStyle(juce::Slider::Rotary);
-    lowPassKnob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
-    lowPassKnob.setRange(20, 20000, 0.01); // Min, Max, Step size
-    lowPassKnob.setValue(20000); // Default value
-
-    fallbackspeed_label.setText("Fall-Back Speed", juce::NotificationType::dontSendNotification);
-    peakhold_label.setText("Peak Hold", juce::NotificationType::dontSendNotification);
-    lowPass_label.setText("Low Pass Filter", juce::NotificationType::dontSendNotification);
-
-
-    none_peak_button.setButtonText("None");
-    fast_peak_button.setButtonText("Fast");
-    medium_peak_button.setButtonText("Medium");
-    slow_peak_button.setButtonText("Slow");
-    buttons[0] = &none_peak_button;
-    buttons[1] = &fast_peak_button;
-    buttons[2] = &medium_peak_button;
-    buttons[3] = &slow_peak_button;
-
-    for (int i = 0; i < 4; ++i)
-    {
-        buttons[i]->addListener(this);  // Add this editor as a listener to each button
-    }
-
-    lowPassKnob.addListener(this);
-
-    none_peak_button.setLookAndFeel(&customButtonLookAndFeel);
-    fast_peak_button.setLookAndFeel(&customButtonLookAndFeel);
-    medium_peak_button.setLookAndFeel(&customButtonLookAndFeel);
-    slow_peak_button.setLookAndFeel(&customButtonLookAndFeel);
-
-    audioVisualizer = new AudioVisualizer(VISUALIZER_WIDTH, VISUALIZER_HEIGHT);
-    spectrumVisualizer = new AudioVisualizer(SPECTRUM_WIDTH, SPECTRUM_HEIGHT);
-    startTimerHz(VISUAL_FRAMERATE); //for visualizer updates
-
-
-
-    addAndMakeVisible(knob);
-    addAndMakeVisible(fallbackspeed_label);
-    addAndMakeVisible(peakhold_label);
-    addAndMakeVisible(none_peak_button);
-    addAndMakeVisible(fast_peak_button);
-    addAndMakeVisible(medium_peak_button);
-    addAndMakeVisible(slow_peak_button);
-    addAndMakeVisible(audioVisualizer);
-    addAndMakeVisible(spectrumVisualizer);
-    addAndMakeVisible(lowPassKnob);
-    addAndMakeVisible(lowPass_label);
-}
-
-
-SpectrumAnalyzerAudioProcessorEditor::~SpectrumAnalyzerAudioProcessorEditor()
-{
-    for (int i = 0; i < 4; ++i)
-    {
-        buttons[i]->removeListener(this);  // Remove listener when editor is destroyed
-    }
-
-    stopTimer();  // Stop the timer when the editor is destroyed
-}
-
-
-//==============================================================================
-void SpectrumAnalyzerAudioProcessorEditor::paint (juce::Graphics& g)
-{
-    // (Our component is opaque, so we must completely fill the background with a solid colour)
-    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-    g.setColour (juce::Colours::white);
-    g.setFont (juce::FontOptions (15.0f));
-}
-
-
-void SpectrumAnalyzerAudioProcessorEditor::resized()
-{
-    // This is generally where you'll want to lay out the positions of any
-    // subcomponents in your editor..
-
-    double fontsize = fallbackspeed_label.getFont().getHeight();
-
-    double x_pos_firstcol = 0.5 * getWidth();
-    fallbackspeed_label.setBounds(x_pos_firstcol, 0.5 * getHeight(), ITEM_SIZE, fontsize);
-    knob.setBounds(x_pos_firstcol, 0.5 * getHeight() + fontsize + PADDING, ITEM_SIZE, ITEM_SIZE);
-
-    double x_pos_secondcol = x_pos_firstcol + ITEM_SIZE + PADDING;
-
-    double x_pos_thirdcol = x_pos_secondcol + BUTTON_WIDTH + PADDING;
-
-    peakhold_label.setBounds(x_pos_secondcol, 0.5 * getHeight(), BUTTON_WIDTH, fontsize);
-
-    none_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING, BUTTON_WIDTH, BUTTON_HEIGHT);
-    fast_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING + (BUTTON_HEIGHT + PADDING), BUTTON_WIDTH, BUTTON_HEIGHT);
-    medium_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING + 2 * (BUTTON_HEIGHT + PADDING), BUTTON_WIDTH, BUTTON_HEIGHT);
-    slow_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING + 3 * (BUTTON_HEIGHT + PADDING), BUTTON_WIDTH, BUTTON_HEIGHT);
-
-    lowPass_label.setBounds(x_pos_thirdcol, 0.5 * getHeight(), ITEM_SIZE, fontsize);
-    lowPassKnob.setBounds(x_pos_thirdcol, 0.5 * getHeight() + fontsize + PADDING, ITEM_SIZE, ITEM_SIZE);
-}
-
-
-void SpectrumAnalyzerAudioProcessorEditor::buttonClicked(juce::Button* button)
-{
-    // Check if the button is being toggled on
-    if (button->getToggleState()) {
-        for (int i = 0; i < 4; i++) {
-            if (buttons[i] != button && buttons[i]->getToggleState()) {
-                // If another button is toggled on, turn it off
-                buttons[i]->setToggleState(false, juce::dontSendNotification);
-            }
-        }
-    }
-}
-
-void SpectrumAnalyzerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
-{
-    if (slider == &lowPassKnob)
-    {
-        // Pass the value from the low-pass knob to the processor
-        audioProcessor.setLowPassFrequency((float)slider->getValue());
-    }
-}
-
-void SpectrumAnalyzerAudioProcessorEditor::timerCallback()
-{
-    // Get the waveform path from the processor (for channel 0)
-    waveformPath = audioProcessor.getWaveformPath(20000, 0, VISUALIZER_HEIGHT, VISUALIZER_WIDTH);  // channel 0
-
-    // Update the visualizer with the new waveform path
-    audioVisualizer->setWaveformPath(waveformPath);
-
-    spectrumPath = audioProcessor.getSpectrumPath(knob.getValue(), 0, SPECTRUM_HEIGHT, SPECTRUM_WIDTH, getPeakHoldMode(), (float)lowPassKnob.getValue()); //channel 0
-    spectrumVisualizer->setWaveformPath(spectrumPath);
-}
-
-int SpectrumAnalyzerAudioProcessorEditor::getPeakHoldMode() {
-    if (none_peak_button.getToggleState()) {
-        return 0;
-    }
-    else if (fast_peak_button.getToggleState()) {
-        return 1;
-    }
-    else if (medium_peak_button.getToggleState()) {
-        return 2;
-    }
-    else if (slow_peak_button.getToggleState()) {
-        return 3;
-    }
-    else{
-        return -1;
-    }
-}
\ No newline at end of file
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#define PADDING 8 //absolute no pixels
+#define ITEM_SIZE 100 //absolute no pixels
+#define BUTTON_HEIGHT 20 //absolute no pixels
+#define BUTTON_WIDTH 60 //absolute no pixels
+#define VISUALIZER_WIDTH 800 //absolute no pixels
+#define VISUALIZER_HEIGHT 150 //absolute no pixels
+#define VISUAL_FRAMERATE 30 //in hertz
+#define SPECTRUM_HEIGHT 250 //absolute no pixels
+#define SPECTRUM_WIDTH 200 //absolute no pixels
+#define SPECTROGRAM_HISTORY 300 //in analysis frames (10 s at VISUAL_FRAMERATE)
+#define MAX_SPECTRUM_ROWS MAX_CAPTURE_CHANNELS //the overlay draws one row per channel; L/R/M/S needs 4, the sidechain view 3
+
+//==============================================================================
+SpectrumAnalyzerAudioProcessorEditor::SpectrumAnalyzerAudioProcessorEditor (SpectrumAnalyzerAudioProcessor& p)
+    : AudioProcessorEditor (&p), audioProcessor (p),
+      frameArena((2 * VISUALIZER_WIDTH + MAX_SPECTRUM_ROWS * SPECTRUM_WIDTH) * (int)sizeof(float) + (2 + MAX_SPECTRUM_ROWS) * (int)FrameArena::alignment)
+{
+    // Make sure that before the constructor has finished, you've set the
+    // editor's size to whatever you need it to be.
+    setSize (400, 300);
+
+    // Enable resizing
+    setResizable(true, true);
+
+    // Set minimum and maximum size (minWidth, minHeight, maxWidth, maxHeight).
+    // The controls start at half the height, so the engine column (engine, FFT size, averaging,
+    // attack) needs 500 px to fit; every other column is full at that width.
+    setResizeLimits(600, 500, 1000, 800);
+
+    // Configure the knob's properties
+    knob.setSliderStyle(juce::Slider::Rotary);
+    knob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
+    knob.setRange(0.1, 10, 0.01); // Min, Max, Step size
+    knob.setValue(0.5); // Default value
+    knob.setTextValueSuffix(" s");
+
+
+    lowPassKnob.setSliderStyle(juce::Slider::Rotary);
+    lowPassKnob.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 50, 20);
+    lowPassKnob.setRange(20, 20000, 0.01); // Min, Max, Step size
+    lowPassKnob.setValue(20000); // Default value
+
+    // Band of the zoom engine; only used while it is selected
+    zoomCentre_slider.setSliderStyle(juce::Slider::LinearBar);
+    zoomCentre_slider.setRange(20, 20000, 0.1);
+    zoomCentre_slider.setSkewFactorFromMidPoint(1000);
+    zoomCentre_slider.setTextValueSuffix(" Hz");
+    zoomCentre_slider.setValue(1000);
+
+    zoomSpan_slider.setSliderStyle(juce::Slider::LinearBar);
+    zoomSpan_slider.setRange(1, 2000, 0.1);
+    zoomSpan_slider.setSkewFactorFromMidPoint(100);
+    zoomSpan_slider.setTextValueSuffix(" Hz span");
+    zoomSpan_slider.setValue(200);
+
+    // Averaging time of the spectrum: the window of a linear average, the release of an exponential one.
+    // It no longer sets the transform size, which has its own box.
+    fallbackspeed_label.setText("Averaging", juce::NotificationType::dontSendNotification);
+    peakhold_label.setText("Peak Hold", juce::NotificationType::dontSendNotification);
+    lowPass_label.setText("Low Pass Filter", juce::NotificationType::dontSendNotification);
+    engine_label.setText("Spectrum Engine", juce::NotificationType::dontSendNotification);
+    zoom_label.setText("Zoom Band", juce::NotificationType::dontSendNotification);
+    channel_label.setText("Channels", juce::NotificationType::dontSendNotification);
+
+    // Item IDs are the SpectrumEngine values plus one (0 means no selection in a ComboBox)
+    engine_box.addItem("FFT", (int)SpectrumEngine::stft + 1);
+    engine_box.addItem("Constant-Q", (int)SpectrumEngine::constantQ + 1);
+    engine_box.addItem("Zoom", (int)SpectrumEngine::zoom + 1);
+    engine_box.setSelectedId((int)SpectrumEngine::stft + 1, juce::NotificationType::dontSendNotification);
+
+    for (int order = 9; order <= 14; ++order)
+        fftSize_box.addItem(juce::String(1 << order) + " pt", order);
+    fftSize_box.setSelectedId(12, juce::NotificationType::dontSendNotification);
+
+    averaging_box.addItem("Linear", (int)SpectrumAveraging::linear + 1);
+    averaging_box.addItem("Exponential", (int)SpectrumAveraging::exponential + 1);
+    averaging_box.setSelectedId((int)SpectrumAveraging::linear + 1, juce::NotificationType::dontSendNotification);
+
+    // Rise time of the exponential average; only used while it is selected
+    attack_slider.setSliderStyle(juce::Slider::LinearBar);
+    attack_slider.setRange(0, 2, 0.01);
+    attack_slider.setSkewFactorFromMidPoint(0.2);
+    attack_slider.setTextValueSuffix(" s attack");
+    attack_slider.setValue(0);
+
+    updateChannelItems();
+    reference_button.setButtonText("Sidechain");
+
+    // Audio callback timing is only collected while its label is switched on
+    processStats_button.setButtonText("DSP load");
+
+
+    none_peak_button.setButtonText("None");
+    fast_peak_button.setButtonText("Fast");
+    medium_peak_button.setButtonText("Medium");
+    slow_peak_button.setButtonText("Slow");
+    buttons[0] = &none_peak_button;
+    buttons[1] = &fast_peak_button;
+    buttons[2] = &medium_peak_button;
+    buttons[3] = &slow_peak_button;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        buttons[i]->addListener(this);  // Add this editor as a listener to each button
+    }
+
+    lowPassKnob.addListener(this);
+
+    none_peak_button.setLookAndFeel(&customButtonLookAndFeel);
+    fast_peak_button.setLookAndFeel(&customButtonLookAndFeel);
+    medium_peak_button.setLookAndFeel(&customButtonLookAndFeel);
+    slow_peak_button.setLookAndFeel(&customButtonLookAndFeel);
+
+    audioVisualizer = new AudioVisualizer(VISUALIZER_WIDTH, VISUALIZER_HEIGHT);
+    spectrumVisualizer = new AudioVisualizer(SPECTRUM_WIDTH, SPECTRUM_HEIGHT);
+    spectrogramView = new SpectrogramView(SPECTROGRAM_HISTORY, SPECTRUM_WIDTH);
+
+    // Room for one segment per column plus the cutoff line, so refilling the paths never grows them
+    audioVisualizer->preallocatePaths(VISUALIZER_WIDTH * AudioVisualizationProcessor::coordinatesPerSegment);
+    spectrumVisualizer->preallocatePaths((SPECTRUM_WIDTH + 1) * AudioVisualizationProcessor::coordinatesPerSegment);
+    startTimerHz(VISUAL_FRAMERATE); //for visualizer updates
+
+
+
+    addAndMakeVisible(knob);
+    addAndMakeVisible(fallbackspeed_label);
+    addAndMakeVisible(peakhold_label);
+    addAndMakeVisible(none_peak_button);
+    addAndMakeVisible(fast_peak_button);
+    addAndMakeVisible(medium_peak_button);
+    addAndMakeVisible(slow_peak_button);
+    addAndMakeVisible(audioVisualizer);
+    addAndMakeVisible(spectrumVisualizer);
+    addAndMakeVisible(spectrogramView);
+    addAndMakeVisible(lowPassKnob);
+    addAndMakeVisible(lowPass_label);
+    addAndMakeVisible(processStats_label);
+    addAndMakeVisible(processStats_button);
+    addAndMakeVisible(engine_label);
+    addAndMakeVisible(engine_box);
+    addAndMakeVisible(fftSize_box);
+    addAndMakeVisible(averaging_box);
+    addAndMakeVisible(attack_slider);
+    addAndMakeVisible(zoom_label);
+    addAndMakeVisible(zoomCentre_slider);
+    addAndMakeVisible(zoomSpan_slider);
+    addAndMakeVisible(channel_label);
+    addAndMakeVisible(channel_box);
+    addAndMakeVisible(reference_button);
+}
+
+
+SpectrumAnalyzerAudioProcessorEditor::~SpectrumAnalyzerAudioProcessorEditor()
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        buttons[i]->removeListener(this);  // Remove listener when editor is destroyed
+    }
+
+    stopTimer();  // Stop the timer when the editor is destroyed
+
+    audioProcessor.setEditorShowsProcessStats(false); // Leaves stats an API caller enabled running
+    audioProcessor.setEditorVisible(false);
+
+    delete spectrogramView;
+}
+
+
+//==============================================================================
+void SpectrumAnalyzerAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // (Our component is opaque, so we must completely fill the background with a solid colour)
+    g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+    g.setColour (juce::Colours::white);
+    g.setFont (juce::FontOptions (15.0f));
+}
+
+
+void SpectrumAnalyzerAudioProcessorEditor::resized()
+{
+    // This is generally where you'll want to lay out the positions of any
+    // subcomponents in your editor..
+
+    double fontsize = fallbackspeed_label.getFont().getHeight();
+
+    double x_pos_firstcol = 0.5 * getWidth();
+    fallbackspeed_label.setBounds(x_pos_firstcol, 0.5 * getHeight(), ITEM_SIZE, fontsize);
+    knob.setBounds(x_pos_firstcol, 0.5 * getHeight() + fontsize + PADDING, ITEM_SIZE, ITEM_SIZE);
+
+    double y_pos_engine = 0.5 * getHeight() + fontsize + 2 * PADDING + ITEM_SIZE;
+    engine_label.setBounds(x_pos_firstcol, y_pos_engine, ITEM_SIZE, fontsize);
+    engine_box.setBounds(x_pos_firstcol, y_pos_engine + fontsize, ITEM_SIZE, BUTTON_HEIGHT);
+    fftSize_box.setBounds(x_pos_firstcol, y_pos_engine + fontsize + (BUTTON_HEIGHT + PADDING / 2), ITEM_SIZE, BUTTON_HEIGHT);
+    averaging_box.setBounds(x_pos_firstcol, y_pos_engine + fontsize + 2 * (BUTTON_HEIGHT + PADDING / 2), ITEM_SIZE, BUTTON_HEIGHT);
+    attack_slider.setBounds(x_pos_firstcol, y_pos_engine + fontsize + 3 * (BUTTON_HEIGHT + PADDING / 2), ITEM_SIZE, BUTTON_HEIGHT);
+
+    double x_pos_secondcol = x_pos_firstcol + ITEM_SIZE + PADDING;
+
+    double x_pos_thirdcol = x_pos_secondcol + BUTTON_WIDTH + PADDING;
+
+    channel_label.setBounds(x_pos_secondcol, y_pos_engine, BUTTON_WIDTH, fontsize);
+    channel_box.setBounds(x_pos_secondcol, y_pos_engine + fontsize, BUTTON_WIDTH, BUTTON_HEIGHT);
+    reference_button.setBounds(x_pos_secondcol, y_pos_engine + fontsize + BUTTON_HEIGHT + PADDING / 2, BUTTON_WIDTH, BUTTON_HEIGHT);
+
+    peakhold_label.setBounds(x_pos_secondcol, 0.5 * getHeight(), BUTTON_WIDTH, fontsize);
+
+    none_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING, BUTTON_WIDTH, BUTTON_HEIGHT);
+    fast_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING + (BUTTON_HEIGHT + PADDING), BUTTON_WIDTH, BUTTON_HEIGHT);
+    medium_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING + 2 * (BUTTON_HEIGHT + PADDING), BUTTON_WIDTH, BUTTON_HEIGHT);
+    slow_peak_button.setBounds(x_pos_secondcol, 0.5 * getHeight() + fontsize + PADDING + 3 * (BUTTON_HEIGHT + PADDING), BUTTON_WIDTH, BUTTON_HEIGHT);
+
+    lowPass_label.setBounds(x_pos_thirdcol, 0.5 * getHeight(), ITEM_SIZE, fontsize);
+    lowPassKnob.setBounds(x_pos_thirdcol, 0.5 * getHeight() + fontsize + PADDING, ITEM_SIZE, ITEM_SIZE);
+
+    zoom_label.setBounds(x_pos_thirdcol, y_pos_engine, ITEM_SIZE, fontsize);
+    zoomCentre_slider.setBounds(x_pos_thirdcol, y_pos_engine + fontsize, ITEM_SIZE, BUTTON_HEIGHT);
+    zoomSpan_slider.setBounds(x_pos_thirdcol, y_pos_engine + fontsize + BUTTON_HEIGHT + PADDING / 2, ITEM_SIZE, BUTTON_HEIGHT);
+
+    processStats_button.setBounds(x_pos_firstcol, 0.5 * getHeight() - fontsize - 2 * PADDING - BUTTON_HEIGHT, ITEM_SIZE, BUTTON_HEIGHT);
+    processStats_label.setBounds(x_pos_firstcol, 0.5 * getHeight() - fontsize - PADDING, getWidth() - x_pos_firstcol, fontsize);
+
+    // Waterfall below the spectrum, left of the controls
+    spectrogramView->setBounds(0, SPECTRUM_HEIGHT + PADDING, x_pos_firstcol - PADDING, getHeight() - SPECTRUM_HEIGHT - 2 * PADDING);
+}
+
+
+void SpectrumAnalyzerAudioProcessorEditor::buttonClicked(juce::Button* button)
+{
+    // Check if the button is being toggled on
+    if (button->getToggleState()) {
+        for (int i = 0; i < 4; i++) {
+            if (buttons[i] != button && buttons[i]->getToggleState()) {
+                // If another button is toggled on, turn it off
+                buttons[i]->setToggleState(false, juce::dontSendNotification);
+            }
+        }
+    }
+}
+
+void SpectrumAnalyzerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
+{
+    if (slider == &lowPassKnob)
+    {
+        // Pass the value from the low-pass knob to the processor
+        audioProcessor.setLowPassFrequency((float)slider->getValue());
+    }
+}
+
+void SpectrumAnalyzerAudioProcessorEditor::timerCallback()
+{
+    // A minimised or hidden editor drops its instance to the background analysis rate
+    audioProcessor.setEditorVisible(isShowing());
+
+    // The bus layout can change while the editor is open
+    if (audioProcessor.getNumCaptureChannels() != numChannelItems)
+        updateChannelItems();
+
+    // Hand the current control values to the analysis thread
+    AnalysisSettings settings;
+    settings.waveformSamples = 20000;
+    settings.waveformColumns = VISUALIZER_WIDTH;
+    settings.fallbackSpeed = knob.getValue();
+    settings.peakHoldMode = getPeakHoldMode();
+    settings.spectrumEngine = (SpectrumEngine)(engine_box.getSelectedId() - 1);
+    settings.stftFrameOrder = fftSize_box.getSelectedId();
+    settings.stftHopSize = juce::jmin(1024, (1 << settings.stftFrameOrder) / 4); // 75 % overlap, but frames never more than 1024 samples apart
+    settings.averaging = (SpectrumAveraging)(averaging_box.getSelectedId() - 1);
+    settings.attackSeconds = (float)attack_slider.getValue();
+    settings.zoomCentreFrequency = (float)zoomCentre_slider.getValue();
+    settings.zoomSpan = (float)zoomSpan_slider.getValue();
+    settings.lowPassFrequency = (float)lowPassKnob.getValue();
+    settings.spectrumColumns = SPECTRUM_WIDTH;
+    settings.overlayChannels = channel_box.getSelectedId() == 1;
+    settings.stereoMidSide = channel_box.getSelectedId() == midSideItemId;
+    settings.channel = settings.overlayChannels || settings.stereoMidSide ? 0 : channel_box.getSelectedId() - 2;
+
+    // Only with a sidechain connected; the comparison uses the FFT engine. A disabled button keeps its
+    // state for when the sidechain comes back, but nothing is compared meanwhile.
+    reference_button.setEnabled(audioProcessor.getNumReferenceChannels() > 0);
+    settings.compareReference = reference_button.isEnabled() && reference_button.getToggleState();
+    audioProcessor.setAnalysisSettings(settings);
+
+    const bool isZoomed = settings.spectrumEngine == SpectrumEngine::zoom;
+    zoomCentre_slider.setEnabled(isZoomed);
+    zoomSpan_slider.setEnabled(isZoomed);
+    attack_slider.setEnabled(settings.averaging == SpectrumAveraging::exponential);
+
+    // Only geometry is built here, the analysis itself already ran on the worker.
+    // Nothing is rebuilt or repainted unless the worker published something new.
+    if (audioProcessor.updateAnalysis())
+    {
+        const AnalysisResult& result = audioProcessor.getLatestAnalysis();
+        const int numSpectrumRows = juce::jmax(1, result.numSpectrumChannels);
+
+        // One curve per analysed channel; only allocates when the number of channels changes
+        if (audioProcessor.hasNewSpectrum())
+            spectrumVisualizer->setNumLayers(numSpectrumRows);
+
+        frameArena.reset();
+
+        {
+            // Geometry is refilled in place, in preallocated paths and arena scratch, so a steady-state
+            // frame makes no heap allocation. Debug builds assert on any operator new in this scope;
+            // "Benchmarks --test" runs the same frames and counts every malloc and realloc as well.
+            RealtimeChecks::ScopedRealtimeSection allocationCheck;
+
+            // Waveform of the channel picked in channel_box (the first one for "All" and "L/R/M/S"),
+            // built into the path the visualizer is not drawing
+            if (audioProcessor.hasNewWaveform())
+                audioProcessor.buildWaveformPath(VISUALIZER_HEIGHT, VISUALIZER_WIDTH, frameArena, audioVisualizer->getBackPath());
+
+            if (audioProcessor.hasNewSpectrum())
+            {
+                for (int row = 0; row < numSpectrumRows; ++row)
+                    audioProcessor.buildSpectrumPath(SPECTRUM_HEIGHT, SPECTRUM_WIDTH, frameArena, spectrumVisualizer->getBackPath(row), row);
+            }
+        }
+
+        if (audioProcessor.hasNewWaveform())
+        {
+            // Hand the new waveform to the visualizer
+            audioVisualizer->swapPaths();
+        }
+
+        if (audioProcessor.hasNewSpectrum())
+        {
+            spectrumVisualizer->swapPaths();
+
+            // One waterfall column per new analysis frame, from the first row of the spectrum
+            if (!result.spectrum.empty())
+                spectrogramView->pushColumn(result.getSpectrumRow(0), result.spectrumColumns, result.spectrumMinDecibels, result.spectrumMaxDecibels);
+        }
+    }
+
+    // Timing is collected only while the label shows it
+    const bool showsProcessStats = processStats_button.getToggleState();
+    audioProcessor.setEditorShowsProcessStats(showsProcessStats);
+    processStats_label.setVisible(showsProcessStats);
+
+    if (showsProcessStats)
+        updateProcessStatsLabel();
+}
+
+void SpectrumAnalyzerAudioProcessorEditor::updateProcessStatsLabel()
+{
+    const ProcessBlockStats::Snapshot stats = audioProcessor.getProcessStats();
+
+    juce::String text;
+    text << "DSP load " << juce::String(stats.lastLoadPercent, 1) << " % (worst " << juce::String(stats.worstLoadPercent, 1)
+         << " %), overruns " << stats.overruns;
+
+    // Only ever non-zero in debug builds
+    if (stats.allocations > 0 || stats.blockingCalls > 0 || stats.denormalCallbacks > 0)
+        text << " | allocations " << stats.allocations << ", locks " << stats.blockingCalls << ", denormals " << stats.denormalCallbacks;
+
+    processStats_label.setText(text, juce::NotificationType::dontSendNotification);
+    processStats_label.setColour(juce::Label::textColourId, stats.worstLoadPercent >= 100.0 ? juce::Colours::red : juce::Colours::white);
+}
+
+int SpectrumAnalyzerAudioProcessorEditor::getPeakHoldMode() {
+    if (none_peak_button.getToggleState()) {
+        return 0;
+    }
+    else if (fast_peak_button.getToggleState()) {
+        return 1;
+    }
+    else if (medium_peak_button.getToggleState()) {
+        return 2;
+    }
+    else if (slow_peak_button.getToggleState()) {
+        return 3;
+    }
+    else{
+        return -1;
+    }
+}
+
+void SpectrumAnalyzerAudioProcessorEditor::updateChannelItems()
+{
+    // Item 1 overlays every channel, item channel + 2 solos one, midSideItemId shows the first pair as
+    // left, right, mid and side; keeps the selection if it still exists
+    const int selectedId = channel_box.getSelectedId();
+    numChannelItems = audioProcessor.getNumCaptureChannels();
+
+    channel_box.clear(juce::NotificationType::dontSendNotification);
+    channel_box.addItem("All", 1);
+
+    for (int channel = 0; channel < numChannelItems; ++channel)
+        channel_box.addItem(audioProcessor.getCaptureChannelName(channel), channel + 2);
+
+    if (numChannelItems >= 2)
+        channel_box.addItem("L/R/M/S", midSideItemId);
+
+    const bool isKept = (selectedId > 0 && selectedId <= numChannelItems + 1) || (selectedId == midSideItemId && numChannelItems >= 2);
+    channel_box.setSelectedId(isKept ? selectedId : 1, juce::NotificationType::dontSendNotification);
+}
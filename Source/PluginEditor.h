@@ -1,57 +1,75 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin editor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "PluginProcessor.h"
-#include "CustomButtonLookAndFeel.h"
-#include "AudioVisualizer.h"
-
-//==============================================================================
-/**
-*/
-class SpectrumAnalyzerAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Button::Listener, public juce::Timer, public juce::Slider::Listener
-{
-public:
-    SpectrumAnalyzerAudioProcessorEditor (SpectrumAnalyzerAudioProcessor&);
-    ~SpectrumAnalyzerAudioProcessorEditor() override;
-
-    //==============================================================================
-    void paint (juce::Graphics&) override;
-    void resized() override;
-    void buttonClicked(juce::Button* button) override;
-    void SpectrumAnalyzerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider) override;
-    void SpectrumAnalyzerAudioProcessorEditor::timerCallback() override;
-
-private:
-
-    int SpectrumAnalyzerAudioProcessorEditor::getPeakHoldMode();
-
-    // This reference is provided as a quick way for your editor to
-    // access the processor object that created it.
-    SpectrumAnalyzerAudioProcessor& audioProcessor;
-
-    juce::ToggleButton none_peak_button;
-    juce::ToggleButton fast_peak_button;
-    juce::ToggleButton medium_peak_button;
-    juce::ToggleButton slow_peak_button;
-    juce::ToggleButton* buttons[4];
-    juce::Slider knob;
-    juce::Slider lowPassKnob;
-    juce::Label fallbackspeed_label;
-    juce::Label lowPass_label;
-    juce::Label peakhold_label;
-    CustomButtonLookAndFeel customButtonLookAndFeel;
-    AudioVisualizer* audioVisualizer;
-    AudioVisualizer* spectrumVisualizer;
-    juce::Path waveformPath;
-    juce::Path spectrumPath;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzerAudioProcessorEditor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "CustomButtonLookAndFeel.h"
+#include "AudioVisualizer.h"
+#include "SpectrogramView.h"
+
+//==============================================================================
+/**
+*/
+class SpectrumAnalyzerAudioProcessorEditor  : public juce::AudioProcessorEditor, public juce::Button::Listener, public juce::Timer, public juce::Slider::Listener
+{
+public:
+    SpectrumAnalyzerAudioProcessorEditor (SpectrumAnalyzerAudioProcessor&);
+    ~SpectrumAnalyzerAudioProcessorEditor() override;
+
+    //==============================================================================
+    void paint (juce::Graphics&) override;
+    void resized() override;
+    void buttonClicked(juce::Button* button) override;
+    void SpectrumAnalyzerAudioProcessorEditor::sliderValueChanged(juce::Slider* slider) override;
+    void SpectrumAnalyzerAudioProcessorEditor::timerCallback() override;
+
+private:
+
+    int SpectrumAnalyzerAudioProcessorEditor::getPeakHoldMode();
+    void updateProcessStatsLabel();
+    void updateChannelItems();
+
+    // This reference is provided as a quick way for your editor to
+    // access the processor object that created it.
+    SpectrumAnalyzerAudioProcessor& audioProcessor;
+
+    juce::ToggleButton none_peak_button;
+    juce::ToggleButton fast_peak_button;
+    juce::ToggleButton medium_peak_button;
+    juce::ToggleButton slow_peak_button;
+    juce::ToggleButton* buttons[4];
+    juce::Slider knob;
+    juce::Slider lowPassKnob;
+    juce::Label fallbackspeed_label;
+    juce::Label lowPass_label;
+    juce::Label peakhold_label;
+    juce::Label processStats_label;
+    juce::ToggleButton processStats_button; ///< Shows the DSP load label, and collects its timing meanwhile.
+    juce::Label engine_label;
+    juce::ComboBox engine_box;
+    juce::ComboBox fftSize_box;   ///< Item IDs are the frame orders.
+    juce::ComboBox averaging_box; ///< Item IDs are the SpectrumAveraging values plus one.
+    juce::Slider attack_slider;
+    juce::Label zoom_label;
+    juce::Slider zoomCentre_slider;
+    juce::Slider zoomSpan_slider;
+    juce::Label channel_label;
+    juce::ComboBox channel_box;
+    int numChannelItems = 0; ///< Captured channels the channel box currently lists.
+    static constexpr int midSideItemId = 100; ///< Channel box item of the stereo left/right/mid/side view.
+    juce::ToggleButton reference_button; ///< Compares the selected channel with the sidechain.
+    CustomButtonLookAndFeel customButtonLookAndFeel;
+    AudioVisualizer* audioVisualizer;
+    AudioVisualizer* spectrumVisualizer;
+    SpectrogramView* spectrogramView;
+    FrameArena frameArena; ///< Scratch for one timer tick's geometry, reset at the start of each.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzerAudioProcessorEditor)
+};
@@ -1,241 +1,339 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#include "PluginProcessor.h"
-#include "PluginEditor.h"
-#define NUM_CHANNELS 3
-#define BUFFER_CAPACITY 80000
-#define TEMPORARY_FALLBACK_SPEED 0.5 //FIXME
-
-//==============================================================================
-SpectrumAnalyzerAudioProcessor::SpectrumAnalyzerAudioProcessor()
-#ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
-                     #if ! JucePlugin_IsMidiEffect
-                      #if ! JucePlugin_IsSynth
-                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
-                      #endif
-                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
-                     #endif
-                       )
-#endif
-{
-    audioVisualizationProcessor = new AudioVisualizationProcessor(BUFFER_CAPACITY, NUM_CHANNELS);
-    sampleRate = 0;
-}
-
-SpectrumAnalyzerAudioProcessor::~SpectrumAnalyzerAudioProcessor()
-{
-}
-
-//==============================================================================
-const juce::String SpectrumAnalyzerAudioProcessor::getName() const
-{
-    return JucePlugin_Name;
-}
-
-bool SpectrumAnalyzerAudioProcessor::acceptsMidi() const
-{
-   #if JucePlugin_WantsMidiInput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool SpectrumAnalyzerAudioProcessor::producesMidi() const
-{
-   #if JucePlugin_ProducesMidiOutput
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-bool SpectrumAnalyzerAudioProcessor::isMidiEffect() const
-{
-   #if JucePlugin_IsMidiEffect
-    return true;
-   #else
-    return false;
-   #endif
-}
-
-double SpectrumAnalyzerAudioProcessor::getTailLengthSeconds() const
-{
-    return 0.0;
-}
-
-int SpectrumAnalyzerAudioProcessor::getNumPrograms()
-{
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
-}
-
-int SpectrumAnalyzerAudioProcessor::getCurrentProgram()
-{
-    return 0;
-}
-
-void SpectrumAnalyzerAudioProcessor::setCurrentProgram (int index)
-{
-}
-
-const juce::String SpectrumAnalyzerAudioProcessor::getProgramName (int index)
-{
-    return {};
-}
-
-void SpectrumAnalyzerAudioProcessor::changeProgramName (int index, const juce::String& newName)
-{
-}
-
-//==============================================================================
-void SpectrumAnalyzerAudioProcessor::prepareToPlay (double _sampleRate, int samplesPerBlock)
-{
-    sampleRate = _sampleRate;
-    audioVisualizationProcessor->setSampleRate((int)_sampleRate);
-    lastSamples.resize(getTotalNumInputChannels(), 0.0f); // One state per channel
-}
-
-void SpectrumAnalyzerAudioProcessor::releaseResources()
-{
-    delete audioVisualizationProcessor;
-    audioVisualizationProcessor = nullptr;
-}
-
-#ifndef JucePlugin_PreferredChannelConfigurations
-bool SpectrumAnalyzerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
-{
-  #if JucePlugin_IsMidiEffect
-    juce::ignoreUnused (layouts);
-    return true;
-  #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
-        return false;
-
-    // This checks if the input layout matches the output layout
-   #if ! JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
-        return false;
-   #endif
-
-    return true;
-  #endif
-}
-#endif
-
-void SpectrumAnalyzerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
-{
-    juce::ScopedNoDenormals noDenormals;
-    auto totalNumInputChannels = getTotalNumInputChannels();
-    auto totalNumOutputChannels = getTotalNumOutputChannels();
-
-    blockSize = buffer.getNumSamples(); // Get the number of samples in the current block
-
-    // Clear any extra output channels
-    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
-        buffer.clear(i, 0, blockSize);
-
-    // Allocate and sum data
-    float* summedData = new float[blockSize];
-    std::fill(summedData, summedData + blockSize, 0.0f);
-
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        const auto* channelData = buffer.getReadPointer(channel);
-
-        for (int sampleIndex = 0; sampleIndex < blockSize; ++sampleIndex)
-        {
-            summedData[sampleIndex] += channelData[sampleIndex];
-        }
-    }
-
-    if (audioVisualizationProcessor != nullptr)
-    {
-        audioVisualizationProcessor->pushAudioData(summedData, blockSize, 0);
-    }
-
-    delete[] summedData;
-
-    // Apply the low-pass filter
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
-    {
-        auto* channelData = buffer.getWritePointer(channel);
-        applyLowpassFilter(channelData, blockSize, lowPassCutoffFrequency, sampleRate, channel);
-    }
-
-}
-
-
-juce::Path SpectrumAnalyzerAudioProcessor::getWaveformPath(int numSamples, int channel, int height, int width) {
-    return audioVisualizationProcessor->getVisualizationPath(numSamples, channel, height, width);
-}
-
-juce::Path SpectrumAnalyzerAudioProcessor::getSpectrumPath(double fallbackSpeed, int channel, int height, int width, int peakHoldMode, float lowPassFrequency) {
-    double numSamples = (double)sampleRate * fallbackSpeed;
-    return audioVisualizationProcessor->getSpectrumPath((int)numSamples, channel, height, width, peakHoldMode, lowPassFrequency);
-}
-
-//==============================================================================
-bool SpectrumAnalyzerAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
-
-juce::AudioProcessorEditor* SpectrumAnalyzerAudioProcessor::createEditor()
-{
-    return new SpectrumAnalyzerAudioProcessorEditor (*this);
-}
-
-//==============================================================================
-void SpectrumAnalyzerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
-{
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-}
-
-void SpectrumAnalyzerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
-{
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-}
-
-//==============================================================================
-// This creates new instances of the plugin..
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
-{
-    return new SpectrumAnalyzerAudioProcessor();
-}
-
-void SpectrumAnalyzerAudioProcessor::applyLowpassFilter(float* data, int numSamples, float cutoffFrequency, double sampleRate, int channel)
-{
-    if (channel >= lastSamples.size() || sampleRate <= 0.0f) // Validate input
-        return;
-
-    float rc = 1.0f / (cutoffFrequency * 2.0f * juce::MathConstants<float>::pi);
-    float dt = 1.0f / static_cast<float>(sampleRate);
-    float alpha = dt / (rc + dt);
-
-    for (int i = 0; i < numSamples; ++i)
-    {
-        data[i] = alpha * data[i] + (1.0f - alpha) * lastSamples[channel];
-        lastSamples[channel] = data[i]; // Update the state
-    }
-}
-
-void SpectrumAnalyzerAudioProcessor::setLowPassFrequency(float frequency)
-{
-    lowPassCutoffFrequency = frequency;
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#define MAX_REFERENCE_CHANNELS 2 // A mono or stereo reference track on the sidechain
+#define TEMPORARY_FALLBACK_SPEED 0.5 //FIXME
+
+//==============================================================================
+SpectrumAnalyzerAudioProcessor::SpectrumAnalyzerAudioProcessor()
+#ifndef JucePlugin_PreferredChannelConfigurations
+     : AudioProcessor (BusesProperties()
+                     #if ! JucePlugin_IsMidiEffect
+                      #if ! JucePlugin_IsSynth
+                       .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::stereo(), false)
+                      #endif
+                       .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                     #endif
+                       )
+#endif
+{
+    audioVisualizationProcessor = new AudioVisualizationProcessor(); // The capture history is allocated in prepareToPlay
+    analysisWorker = new AnalysisWorker(*audioVisualizationProcessor);
+    sampleRate = 0;
+    captureBlockSize = 1;
+    theresNewDataSpectrum = false;
+    theresNewDataWave = false;
+    lastSeenWaveformVersion = 0;
+    lastSeenSpectrumVersion = 0;
+}
+
+SpectrumAnalyzerAudioProcessor::~SpectrumAnalyzerAudioProcessor()
+{
+    delete analysisWorker; // Leaves the analysis scheduler before the data it reads goes away
+    delete audioVisualizationProcessor;
+}
+
+//==============================================================================
+const juce::String SpectrumAnalyzerAudioProcessor::getName() const
+{
+    return JucePlugin_Name;
+}
+
+bool SpectrumAnalyzerAudioProcessor::acceptsMidi() const
+{
+   #if JucePlugin_WantsMidiInput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool SpectrumAnalyzerAudioProcessor::producesMidi() const
+{
+   #if JucePlugin_ProducesMidiOutput
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+bool SpectrumAnalyzerAudioProcessor::isMidiEffect() const
+{
+   #if JucePlugin_IsMidiEffect
+    return true;
+   #else
+    return false;
+   #endif
+}
+
+double SpectrumAnalyzerAudioProcessor::getTailLengthSeconds() const
+{
+    return 0.0;
+}
+
+int SpectrumAnalyzerAudioProcessor::getNumPrograms()
+{
+    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
+                // so this should be at least 1, even if you're not really implementing programs.
+}
+
+int SpectrumAnalyzerAudioProcessor::getCurrentProgram()
+{
+    return 0;
+}
+
+void SpectrumAnalyzerAudioProcessor::setCurrentProgram (int index)
+{
+}
+
+const juce::String SpectrumAnalyzerAudioProcessor::getProgramName (int index)
+{
+    return {};
+}
+
+void SpectrumAnalyzerAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+}
+
+//==============================================================================
+void SpectrumAnalyzerAudioProcessor::prepareToPlay (double _sampleRate, int samplesPerBlock)
+{
+    sampleRate = _sampleRate;
+
+    // Size the capture history for what the display currently asks for; the analysis grows it later if needed
+    analysisWorker->stop();
+    captureBlockSize = juce::jmax(1, samplesPerBlock);
+    referenceSilence.calloc((size_t)captureBlockSize);
+    audioVisualizationProcessor->prepare((int)_sampleRate, getNumCaptureChannels(), captureBlockSize, analysisWorker->getSettings(),
+                                         getNumReferenceChannels());
+    lowPassFilter.prepare(_sampleRate, samplesPerBlock, getMainBusNumInputChannels()); // All channels in SIMD lanes
+
+    analysisWorker->start();
+}
+
+void SpectrumAnalyzerAudioProcessor::releaseResources()
+{
+    analysisWorker->stop();
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+bool SpectrumAnalyzerAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
+{
+  #if JucePlugin_IsMidiEffect
+    juce::ignoreUnused (layouts);
+    return true;
+  #else
+    // Any layout up to MAX_CAPTURE_CHANNELS, from mono to 7.1.4 and beyond; every channel is captured
+    // and analysed on its own
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || layouts.getMainOutputChannelSet().size() > MAX_CAPTURE_CHANNELS)
+        return false;
+
+    // This checks if the input layout matches the output layout
+   #if ! JucePlugin_IsSynth
+    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+        return false;
+
+    // The sidechain is only captured for comparison, so it may be off
+    if (layouts.inputBuses.size() > 1 && layouts.getChannelSet(true, 1).size() > MAX_REFERENCE_CHANNELS)
+        return false;
+   #endif
+
+    return true;
+  #endif
+}
+#endif
+
+void SpectrumAnalyzerAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    ProcessBlockStats::ScopedMeasurement measurement(processStats, buffer.getNumSamples(), sampleRate);
+    RealtimeChecks::ScopedRealtimeSection realtimeSection; // Debug builds assert on any heap allocation or checked lock below
+    juce::ScopedNoDenormals noDenormals;
+    auto totalNumInputChannels = getMainBusNumInputChannels(); // The sidechain is not passed through
+    auto totalNumOutputChannels = getTotalNumOutputChannels();
+
+    blockSize = buffer.getNumSamples(); // Get the number of samples in the current block
+
+    // Clear any extra output channels
+    for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
+        buffer.clear(i, 0, blockSize);
+
+    if (audioVisualizationProcessor != nullptr)
+    {
+        // Each input channel goes to its own ring channel, no mixdown. If the layout grew since
+        // prepareToPlay, the extra channels are not captured until the next one.
+        const int numCaptured = juce::jmin(totalNumInputChannels, audioVisualizationProcessor->getNumChannels());
+
+        // The sidechain goes to the reference ring; a channel the host stopped sending repeats its neighbour,
+        // and a bus handed over without any channels reads as silence, so the reference keeps pace with the input
+        const auto sidechain = getBusCount(true) > 1 ? getBusBuffer(buffer, true, 1) : juce::AudioBuffer<float>();
+        const int numReference = audioVisualizationProcessor->getNumReferenceChannels();
+
+        // In chunks of the prepared size, in case the host exceeds it
+        for (int start = 0; start < blockSize; start += captureBlockSize)
+        {
+            const int numSamples = juce::jmin(captureBlockSize, blockSize - start);
+
+            for (int channel = 0; channel < numCaptured; ++channel)
+                audioVisualizationProcessor->pushAudioData(buffer.getReadPointer(channel, start), numSamples, channel);
+
+            for (int channel = 0; channel < numReference; ++channel)
+            {
+                const float* reference = sidechain.getNumChannels() > 0
+                                       ? sidechain.getReadPointer(juce::jmin(channel, sidechain.getNumChannels() - 1), start)
+                                       : referenceSilence.get();
+                audioVisualizationProcessor->pushReferenceData(reference, numSamples, channel);
+            }
+        }
+    }
+
+    // Apply the low-pass filter
+    lowPassFilter.process(buffer, totalNumInputChannels, blockSize);
+
+    processStats.checkDenormals(buffer, totalNumOutputChannels, blockSize);
+}
+
+
+void SpectrumAnalyzerAudioProcessor::setAnalysisSettings(const AnalysisSettings& settings) {
+    analysisWorker->setSettings(settings);
+}
+
+void SpectrumAnalyzerAudioProcessor::setAnalysisPriority(juce::Thread::Priority priority) {
+    analysisWorker->setAnalysisPriority(priority);
+}
+
+void SpectrumAnalyzerAudioProcessor::setEditorVisible(bool isVisible) {
+    analysisWorker->setEditorVisible(isVisible);
+}
+
+bool SpectrumAnalyzerAudioProcessor::updateAnalysis() {
+    theresNewDataWave = false;
+    theresNewDataSpectrum = false;
+
+    if (! analysisWorker->updateLatestResult())
+        return false;
+
+    // A result can be new for one view and unchanged for the other
+    const AnalysisResult& result = analysisWorker->getLatestResult();
+    theresNewDataWave = result.waveformVersion != lastSeenWaveformVersion;
+    theresNewDataSpectrum = result.spectrumVersion != lastSeenSpectrumVersion;
+    lastSeenWaveformVersion = result.waveformVersion;
+    lastSeenSpectrumVersion = result.spectrumVersion;
+
+    return theresNewDataWave || theresNewDataSpectrum;
+}
+
+bool SpectrumAnalyzerAudioProcessor::hasNewWaveform() const {
+    return theresNewDataWave;
+}
+
+bool SpectrumAnalyzerAudioProcessor::hasNewSpectrum() const {
+    return theresNewDataSpectrum;
+}
+
+void SpectrumAnalyzerAudioProcessor::setProcessStatsEnabled(bool shouldBeEnabled) {
+    processStatsRequested = shouldBeEnabled;
+    processStats.setEnabled(processStatsRequested || editorShowsProcessStats);
+}
+
+void SpectrumAnalyzerAudioProcessor::setEditorShowsProcessStats(bool isShowing) {
+    editorShowsProcessStats = isShowing;
+    processStats.setEnabled(processStatsRequested || editorShowsProcessStats);
+}
+
+ProcessBlockStats::Snapshot SpectrumAnalyzerAudioProcessor::getProcessStats() const {
+    return processStats.getSnapshot();
+}
+
+void SpectrumAnalyzerAudioProcessor::resetProcessStats() {
+    processStats.reset();
+}
+
+const AnalysisResult& SpectrumAnalyzerAudioProcessor::getLatestAnalysis() const {
+    return analysisWorker->getLatestResult();
+}
+
+void SpectrumAnalyzerAudioProcessor::buildWaveformPath(int height, int width, FrameArena& arena, juce::Path& path) const {
+    AudioVisualizationProcessor::buildVisualizationPath(analysisWorker->getLatestResult(), height, width, arena, path);
+}
+
+void SpectrumAnalyzerAudioProcessor::buildSpectrumPath(int height, int width, FrameArena& arena, juce::Path& path, int row) const {
+    AudioVisualizationProcessor::buildSpectrumPath(analysisWorker->getLatestResult(), height, width, arena, path, row);
+}
+
+//==============================================================================
+bool SpectrumAnalyzerAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* SpectrumAnalyzerAudioProcessor::createEditor()
+{
+    return new SpectrumAnalyzerAudioProcessorEditor (*this);
+}
+
+//==============================================================================
+void SpectrumAnalyzerAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    // You should use this method to store your parameters in the memory block.
+    // You could do that either as raw data, or use the XML or ValueTree classes
+    // as intermediaries to make it easy to save and load complex data.
+}
+
+void SpectrumAnalyzerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    // You should use this method to restore your parameters from this memory block,
+    // whose contents will have been created by the getStateInformation() call.
+}
+
+//==============================================================================
+// This creates new instances of the plugin..
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
+{
+    return new SpectrumAnalyzerAudioProcessor();
+}
+
+void SpectrumAnalyzerAudioProcessor::setLowPassFrequency(float frequency)
+{
+    lowPassFilter.setCutoff(frequency);
+}
+
+void SpectrumAnalyzerAudioProcessor::setLowPassSlope(FilterBank::Slope slope)
+{
+    lowPassFilter.setSlope(slope);
+}
+
+int SpectrumAnalyzerAudioProcessor::getNumCaptureChannels() const
+{
+    return juce::jlimit(1, MAX_CAPTURE_CHANNELS, getMainBusNumInputChannels());
+}
+
+int SpectrumAnalyzerAudioProcessor::getNumReferenceChannels() const
+{
+    return getBusCount(true) > 1 ? juce::jmin(MAX_REFERENCE_CHANNELS, getChannelCountOfBus(true, 1)) : 0;
+}
+
+juce::String SpectrumAnalyzerAudioProcessor::getCaptureChannelName(int channel) const
+{
+    if (auto* bus = getBus(true, 0))
+    {
+        const juce::AudioChannelSet layout = bus->getCurrentLayout();
+
+        const juce::String name = channel < layout.size() ? juce::AudioChannelSet::getAbbreviatedChannelTypeName(layout.getTypeOfChannel(channel))
+                                                          : juce::String();
+        if (name.isNotEmpty())
+            return name;
+    }
+
+    // Discrete channels have no type name
+
+    return juce::String(channel + 1);
 }
\ No newline at end of file
@@ -1,75 +1,109 @@
-/*
-  ==============================================================================
-
-    This file contains the basic framework code for a JUCE plugin processor.
-
-  ==============================================================================
-*/
-
-#pragma once
-
-#include <JuceHeader.h>
-#include "CircularBuffer.h"
-#include "AudioVisualizationProcessor.h"
-
-//==============================================================================
-/**
-*/
-class SpectrumAnalyzerAudioProcessor  : public juce::AudioProcessor
-{
-public:
-    //==============================================================================
-    SpectrumAnalyzerAudioProcessor();
-    ~SpectrumAnalyzerAudioProcessor() override;
-
-    //==============================================================================
-    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
-    void releaseResources() override;
-
-   #ifndef JucePlugin_PreferredChannelConfigurations
-    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
-   #endif
-
-    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
-
-    //==============================================================================
-    juce::AudioProcessorEditor* createEditor() override;
-    bool hasEditor() const override;
-
-    //==============================================================================
-    const juce::String getName() const override;
-
-    bool acceptsMidi() const override;
-    bool producesMidi() const override;
-    bool isMidiEffect() const override;
-    double getTailLengthSeconds() const override;
-
-    //==============================================================================
-    int getNumPrograms() override;
-    int getCurrentProgram() override;
-    void setCurrentProgram (int index) override;
-    const juce::String getProgramName (int index) override;
-    void changeProgramName (int index, const juce::String& newName) override;
-
-    //==============================================================================
-    void getStateInformation (juce::MemoryBlock& destData) override;
-    void setStateInformation (const void* data, int sizeInBytes) override;
-
-    juce::Path getWaveformPath(int numSamples, int channel, int height, int width);
-    juce::Path getSpectrumPath(double fallbackSpeed, int channel, int height, int width, int peakHoldMode, float lowPassFrequency);
-
-    void setLowPassFrequency(float frequency);
-private:
-    //==============================================================================
-
-    void SpectrumAnalyzerAudioProcessor::applyLowpassFilter(float* data, int numSamples, float cutoffFrequency, double sampleRate, int channel);
-    int sampleRate;
-    int blockSize;
-    AudioVisualizationProcessor* audioVisualizationProcessor;
-    bool theresNewDataSpectrum;
-    bool theresNewDataWave;
-    std::vector<float> lastSamples;
-    float lowPassCutoffFrequency;
-
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzerAudioProcessor)
-};
+/*
+  ==============================================================================
+
+    This file contains the basic framework code for a JUCE plugin processor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "CircularBuffer.h"
+#include "AudioVisualizationProcessor.h"
+#include "AnalysisWorker.h"
+#include "RealtimeChecks.h"
+#include "FilterBank.h"
+#include "ProcessBlockStats.h"
+#define MAX_CAPTURE_CHANNELS 16 // Every input channel is captured on its own; enough for 9.1.6
+
+//==============================================================================
+/**
+*/
+class SpectrumAnalyzerAudioProcessor  : public juce::AudioProcessor
+{
+public:
+    //==============================================================================
+    SpectrumAnalyzerAudioProcessor();
+    ~SpectrumAnalyzerAudioProcessor() override;
+
+    //==============================================================================
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override;
+    void releaseResources() override;
+
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
+   #endif
+
+    void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+
+    //==============================================================================
+    juce::AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override;
+
+    //==============================================================================
+    const juce::String getName() const override;
+
+    bool acceptsMidi() const override;
+    bool producesMidi() const override;
+    bool isMidiEffect() const override;
+    double getTailLengthSeconds() const override;
+
+    //==============================================================================
+    int getNumPrograms() override;
+    int getCurrentProgram() override;
+    void setCurrentProgram (int index) override;
+    const juce::String getProgramName (int index) override;
+    void changeProgramName (int index, const juce::String& newName) override;
+
+    //==============================================================================
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+    // Display analysis: settings go to the analysis thread, results come back through updateAnalysis()
+    void setAnalysisSettings(const AnalysisSettings& settings);
+    void setAnalysisPriority(juce::Thread::Priority priority);
+    void setEditorVisible(bool isVisible); // Visible instances get the shared analysis pool first
+    bool updateAnalysis(); // True if the waveform or the spectrum changed since the last call
+    bool hasNewWaveform() const;
+    bool hasNewSpectrum() const;
+    const AnalysisResult& getLatestAnalysis() const;
+    void buildWaveformPath(int height, int width, FrameArena& arena, juce::Path& path) const;
+    void buildSpectrumPath(int height, int width, FrameArena& arena, juce::Path& path, int row = 0) const;
+
+    void setLowPassFrequency(float frequency);
+    void setLowPassSlope(FilterBank::Slope slope);
+
+    // Channels of the main input captured for display, each on its own, and a short name for each
+    int getNumCaptureChannels() const;
+    juce::String getCaptureChannelName(int channel) const;
+
+    // Channels of the optional sidechain captured as a reference to compare against, 0 while it is off
+    int getNumReferenceChannels() const;
+
+    // processBlock timing against the buffer deadline, off until enabled; readable from any thread.
+    // Collected while either an API caller or the editor's stats toggle asks for it.
+    void setProcessStatsEnabled(bool shouldBeEnabled);
+    void setEditorShowsProcessStats(bool isShowing);
+    ProcessBlockStats::Snapshot getProcessStats() const;
+    void resetProcessStats();
+private:
+    //==============================================================================
+
+    int sampleRate;
+    int blockSize;
+    AudioVisualizationProcessor* audioVisualizationProcessor;
+    AnalysisWorker* analysisWorker;
+    int captureBlockSize; // Largest push the capture history was prepared for
+    juce::HeapBlock<float> referenceSilence; // captureBlockSize zeros, pushed for a sidechain the host sends no channels of
+    bool theresNewDataSpectrum; // Set by updateAnalysis() for the message thread
+    bool theresNewDataWave;
+    uint64_t lastSeenWaveformVersion; // Versions of the last result handed to the editor
+    uint64_t lastSeenSpectrumVersion;
+    FilterBank lowPassFilter; // Cutoff and slope are handed over from the GUI lock-free
+    ProcessBlockStats processStats;
+    std::atomic<bool> processStatsRequested { false }; // Through setProcessStatsEnabled()
+    std::atomic<bool> editorShowsProcessStats { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzerAudioProcessor)
+};
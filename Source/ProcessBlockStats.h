@@ -0,0 +1,201 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+#include "RealtimeChecks.h"
+
+/**
+ * ProcessBlockStats: opt-in timing of the audio callback against the host's deadline.
+ * The audio thread is the only writer; every counter is a relaxed atomic, so the editor or
+ * any other thread can read a Snapshot at any time without locking. Fields of a snapshot
+ * are read one by one and may come from neighbouring callbacks, which is fine for monitoring.
+ *
+ * Load is the callback duration as a percentage of the buffer's real-time length
+ * (numSamples / sampleRate); anything at or above 100 % is an overrun.
+ */
+class ProcessBlockStats
+{
+public:
+    // Bin 0: below 2^-10 of the buffer time, bin k: [2^(k-11), 2^(k-10)), last bin: overruns
+    static constexpr int numHistogramBins = 12;
+
+    struct Snapshot
+    {
+        juce::int64 callbacks = 0;
+        double lastMicroseconds = 0.0;
+        double meanMicroseconds = 0.0;
+        double worstMicroseconds = 0.0;
+        double lastLoadPercent = 0.0;
+        double meanLoadPercent = 0.0;
+        double worstLoadPercent = 0.0;
+        juce::int64 overruns = 0;
+        juce::int64 histogram[numHistogramBins] = {};
+
+        // Debug builds only, always zero in release
+        int allocations = 0;                 // Heap allocations inside real-time sections (process-wide)
+        int blockingCalls = 0;               // Locks taken inside real-time sections (process-wide)
+        juce::int64 denormalCallbacks = 0;   // Callbacks that ran without flush-to-zero or produced subnormals
+    };
+
+    // Lower edge of a histogram bin, in percent of the buffer time
+    static double getHistogramBinStartPercent(int bin)
+    {
+        return bin == 0 ? 0.0 : 100.0 * std::ldexp(1.0, bin - (numHistogramBins - 1));
+    }
+
+    ProcessBlockStats() = default;
+
+    // Any thread. Disabled instrumentation costs one relaxed load per callback.
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Any thread: the counters are cleared by the audio thread at the start of its next callback
+    void reset() { resetRequested.store(true, std::memory_order_relaxed); }
+
+    Snapshot getSnapshot() const
+    {
+        Snapshot snapshot;
+        snapshot.callbacks = callbacks.load(std::memory_order_relaxed);
+        snapshot.lastMicroseconds = lastMicroseconds.load(std::memory_order_relaxed);
+        snapshot.worstMicroseconds = worstMicroseconds.load(std::memory_order_relaxed);
+        snapshot.lastLoadPercent = lastLoadPercent.load(std::memory_order_relaxed);
+        snapshot.worstLoadPercent = worstLoadPercent.load(std::memory_order_relaxed);
+        snapshot.overruns = overruns.load(std::memory_order_relaxed);
+
+        if (snapshot.callbacks > 0)
+        {
+            snapshot.meanMicroseconds = totalMicroseconds.load(std::memory_order_relaxed) / (double)snapshot.callbacks;
+            snapshot.meanLoadPercent = totalLoadPercent.load(std::memory_order_relaxed) / (double)snapshot.callbacks;
+        }
+
+        for (int bin = 0; bin < numHistogramBins; ++bin)
+            snapshot.histogram[bin] = histogram[bin].load(std::memory_order_relaxed);
+
+        snapshot.allocations = RealtimeChecks::getAllocationCount();
+        snapshot.blockingCalls = RealtimeChecks::getBlockingCallCount();
+        snapshot.denormalCallbacks = denormalCallbacks.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+    // Audio thread: times the enclosing scope as one callback of numSamples at sampleRate
+    class ScopedMeasurement
+    {
+    public:
+        ScopedMeasurement(ProcessBlockStats& _stats, int _numSamples, double _sampleRate) noexcept
+            : stats(_stats), numSamples(_numSamples), sampleRate(_sampleRate),
+              startTicks(_stats.isEnabled() ? juce::Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedMeasurement() noexcept
+        {
+            if (startTicks != 0)
+                stats.record(juce::Time::getHighResolutionTicks() - startTicks, numSamples, sampleRate);
+        }
+
+    private:
+        ProcessBlockStats& stats;
+        const int numSamples;
+        const double sampleRate;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedMeasurement)
+    };
+
+    // Audio thread, debug builds: flags a callback that ran without flush-to-zero or left subnormals in its output
+    void checkDenormals(const juce::AudioBuffer<float>& buffer, int numChannels, int numSamples) noexcept
+    {
+       #if JUCE_DEBUG
+        if (! isEnabled())
+            return;
+
+        bool found = ! juce::FloatVectorOperations::areDenormalsDisabled();
+
+        for (int channel = 0; channel < numChannels && ! found; ++channel)
+        {
+            const float* data = buffer.getReadPointer(channel);
+            for (int i = 0; i < numSamples && ! found; ++i)
+                found = std::fpclassify(data[i]) == FP_SUBNORMAL;
+        }
+
+        if (found)
+            denormalCallbacks.store(denormalCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+       #else
+        juce::ignoreUnused(buffer, numChannels, numSamples);
+       #endif
+    }
+
+private:
+    void record(juce::int64 ticks, int numSamples, double sampleRate) noexcept
+    {
+        if (resetRequested.exchange(false, std::memory_order_relaxed))
+            clear();
+
+        const double microseconds = 1.0e6 * juce::Time::highResolutionTicksToSeconds(ticks);
+        const double bufferMicroseconds = sampleRate > 0.0 ? 1.0e6 * numSamples / sampleRate : 0.0;
+        const double loadPercent = bufferMicroseconds > 0.0 ? 100.0 * microseconds / bufferMicroseconds : 0.0;
+
+        // Single writer: plain load/store pairs are enough, no read-modify-write needed
+        callbacks.store(callbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        totalMicroseconds.store(totalMicroseconds.load(std::memory_order_relaxed) + microseconds, std::memory_order_relaxed);
+        totalLoadPercent.store(totalLoadPercent.load(std::memory_order_relaxed) + loadPercent, std::memory_order_relaxed);
+        lastMicroseconds.store(microseconds, std::memory_order_relaxed);
+        lastLoadPercent.store(loadPercent, std::memory_order_relaxed);
+
+        if (microseconds > worstMicroseconds.load(std::memory_order_relaxed))
+            worstMicroseconds.store(microseconds, std::memory_order_relaxed);
+
+        if (loadPercent > worstLoadPercent.load(std::memory_order_relaxed))
+            worstLoadPercent.store(loadPercent, std::memory_order_relaxed);
+
+        if (loadPercent >= 100.0)
+            overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        auto& bin = histogram[getHistogramBin(loadPercent)];
+        bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static int getHistogramBin(double loadPercent) noexcept
+    {
+        if (loadPercent <= 0.0)
+            return 0;
+
+        // frexp gives load = m * 2^exponent with m in [0.5, 1), so floor(log2(load)) = exponent - 1
+        int exponent = 0;
+        std::frexp(loadPercent * 0.01, &exponent);
+        return juce::jlimit(0, numHistogramBins - 1, exponent - 1 + (numHistogramBins - 1));
+    }
+
+    void clear() noexcept
+    {
+        callbacks.store(0, std::memory_order_relaxed);
+        totalMicroseconds.store(0.0, std::memory_order_relaxed);
+        totalLoadPercent.store(0.0, std::memory_order_relaxed);
+        lastMicroseconds.store(0.0, std::memory_order_relaxed);
+        lastLoadPercent.store(0.0, std::memory_order_relaxed);
+        worstMicroseconds.store(0.0, std::memory_order_relaxed);
+        worstLoadPercent.store(0.0, std::memory_order_relaxed);
+        overruns.store(0, std::memory_order_relaxed);
+        denormalCallbacks.store(0, std::memory_order_relaxed);
+
+        for (auto& bin : histogram)
+            bin.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<bool> enabled { false };
+    std::atomic<bool> resetRequested { false };
+
+    std::atomic<juce::int64> callbacks { 0 };
+    std::atomic<double> totalMicroseconds { 0.0 };
+    std::atomic<double> totalLoadPercent { 0.0 };
+    std::atomic<double> lastMicroseconds { 0.0 };
+    std::atomic<double> lastLoadPercent { 0.0 };
+    std::atomic<double> worstMicroseconds { 0.0 };
+    std::atomic<double> worstLoadPercent { 0.0 };
+    std::atomic<juce::int64> overruns { 0 };
+    std::atomic<juce::int64> histogram[numHistogramBins] = {};
+    std::atomic<juce::int64> denormalCallbacks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessBlockStats)
+};
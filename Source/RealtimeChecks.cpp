@@ -0,0 +1,134 @@
+#include "RealtimeChecks.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if JUCE_DEBUG
+
+namespace
+{
+    thread_local bool insideRealtimeSection = false;
+    std::atomic<int> realtimeAllocationCount { 0 };
+    std::atomic<int> realtimeBlockingCallCount { 0 };
+
+    void noteAllocation()
+    {
+        if (insideRealtimeSection)
+        {
+            ++realtimeAllocationCount;
+
+            // Leave the section while asserting, the assertion handler may allocate itself
+            insideRealtimeSection = false;
+
+            // Heap allocation on a real-time thread: this can block on the allocator's lock
+            jassertfalse;
+
+            insideRealtimeSection = true;
+        }
+    }
+
+    void* allocate(std::size_t size)
+    {
+        noteAllocation();
+
+        if (void* pointer = std::malloc(size == 0 ? 1 : size))
+            return pointer;
+
+        throw std::bad_alloc();
+    }
+
+    // Over-aligned types (alignas above the default) come through here; libstdc++ does not route
+    // them through the plain operator new, so they need their own replacement
+    void* allocateAligned(std::size_t size, std::align_val_t alignment)
+    {
+        noteAllocation();
+
+        // Over-allocate like AlignedBuffer and keep the raw pointer just in front of the aligned block
+        const std::size_t align = std::max(static_cast<std::size_t>(alignment), sizeof(void*));
+
+        if (void* raw = std::malloc(size + align + sizeof(void*)))
+        {
+            const auto address = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+            void** aligned = reinterpret_cast<void**>((address + align - 1) & ~static_cast<std::uintptr_t>(align - 1));
+            aligned[-1] = raw;
+            return aligned;
+        }
+
+        throw std::bad_alloc();
+    }
+
+    void freeAligned(void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            std::free(static_cast<void**>(pointer)[-1]);
+    }
+}
+
+bool RealtimeChecks::enterSection() noexcept
+{
+    const bool wasInside = insideRealtimeSection;
+    insideRealtimeSection = true;
+    return wasInside;
+}
+
+void RealtimeChecks::leaveSection(bool wasInside) noexcept
+{
+    insideRealtimeSection = wasInside;
+}
+
+void RealtimeChecks::noteBlockingCall() noexcept
+{
+    if (! insideRealtimeSection)
+        return;
+
+    ++realtimeBlockingCallCount;
+
+    insideRealtimeSection = false;
+
+    // Lock taken on a real-time thread: the owner may hold it for an unbounded time
+    jassertfalse;
+
+    insideRealtimeSection = true;
+}
+
+bool RealtimeChecks::isInsideRealtimeSection() noexcept
+{
+    return insideRealtimeSection;
+}
+
+int RealtimeChecks::getAllocationCount() noexcept
+{
+    return realtimeAllocationCount.load();
+}
+
+int RealtimeChecks::getBlockingCallCount() noexcept
+{
+    return realtimeBlockingCallCount.load();
+}
+
+// Replacements for the global allocation functions of this binary (debug builds only)
+void* operator new(std::size_t size) { return allocate(size); }
+void* operator new[](std::size_t size) { return allocate(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocateAligned(size, alignment); }
+void operator delete(void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept { freeAligned(pointer); }
+
+#else
+
+bool RealtimeChecks::enterSection() noexcept { return false; }
+void RealtimeChecks::leaveSection(bool) noexcept {}
+void RealtimeChecks::noteBlockingCall() noexcept {}
+bool RealtimeChecks::isInsideRealtimeSection() noexcept { return false; }
+int RealtimeChecks::getAllocationCount() noexcept { return 0; }
+int RealtimeChecks::getBlockingCallCount() noexcept { return 0; }
+
+#endif
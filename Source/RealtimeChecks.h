@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * RealtimeChecks: debug-build guards for code that must stay real-time safe.
+ * While a ScopedRealtimeSection is alive on a thread, every global operator new
+ * on that thread is counted and trips a jassert, and so does every lock taken
+ * through ScopedCheckedLock. Release builds compile all of this down to nothing.
+ */
+struct RealtimeChecks
+{
+    // Marks the current thread as running real-time code for the lifetime of the object
+    class ScopedRealtimeSection
+    {
+    public:
+       #if JUCE_DEBUG
+        ScopedRealtimeSection() noexcept : wasInside(enterSection()) {}
+        ~ScopedRealtimeSection() noexcept { leaveSection(wasInside); }
+       #else
+        ScopedRealtimeSection() noexcept {}
+       #endif
+
+    private:
+       #if JUCE_DEBUG
+        bool wasInside;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedRealtimeSection)
+    };
+
+    // Drop-in for LockType::ScopedLockType. Every lock in the plug-in is taken through it, so one that
+    // becomes reachable from processBlock (or another real-time section) is caught in debug builds.
+    template <typename LockType>
+    class ScopedCheckedLock
+    {
+    public:
+        explicit ScopedCheckedLock(LockType& _lock) noexcept : lock(_lock)
+        {
+            noteBlockingCall();
+            lock.enter();
+        }
+
+        ~ScopedCheckedLock() noexcept { lock.exit(); }
+
+    private:
+        LockType& lock;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedCheckedLock)
+    };
+
+    // Records a call that may block (a lock, a wait); asserts if made inside a real-time section
+    static void noteBlockingCall() noexcept;
+
+    // True if the calling thread is inside a ScopedRealtimeSection (always false in release builds)
+    static bool isInsideRealtimeSection() noexcept;
+
+    // Number of heap allocations made inside real-time sections so far, over all threads
+    static int getAllocationCount() noexcept;
+
+    // Number of blocking calls noted inside real-time sections so far, over all threads
+    static int getBlockingCallCount() noexcept;
+
+private:
+    static bool enterSection() noexcept;
+    static void leaveSection(bool wasInside) noexcept;
+};
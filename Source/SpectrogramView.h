@@ -0,0 +1,91 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+/**
+ * SpectrogramView: a scrolling waterfall of past spectra.
+ * Each analysis frame becomes one column of a persistent image that is addressed as a ring,
+ * written through a precomputed colour lookup table. Painting blits the two wrapped halves of
+ * the ring side by side, so the cost per frame is one column write plus one image blit,
+ * however long the history is.
+ */
+class SpectrogramView : public juce::Component
+{
+public:
+    // historyLength = number of frames kept, numRows = values per frame (low frequencies first)
+    explicit SpectrogramView(int historyLength, int numRows)
+        : image(juce::Image::RGB, historyLength, numRows, true)
+    {
+        buildColourTable();
+        setOpaque(true);
+    }
+
+    // Adds one frame of levels in dB, scaled between minDecibels (black) and maxDecibels (white)
+    void pushColumn(const float* decibels, int numValues, float minDecibels, float maxDecibels)
+    {
+        const int numRows = image.getHeight();
+        const float scale = (float)(colourTableSize - 1) / (maxDecibels - minDecibels);
+
+        {
+            juce::Image::BitmapData pixels(image, writeColumn, 0, 1, numRows, juce::Image::BitmapData::writeOnly);
+
+            for (int row = 0; row < numRows; ++row)
+            {
+                // Row 0 is the top of the image: highest frequency
+                const int valueIndex = juce::jmin(numValues - 1, (numRows - 1 - row) * numValues / numRows);
+                const int colourIndex = juce::jlimit(0, colourTableSize - 1, (int)((decibels[valueIndex] - minDecibels) * scale));
+                pixels.setPixelColour(0, row, colourTable[colourIndex]);
+            }
+        }
+
+        writeColumn = (writeColumn + 1) % image.getWidth();
+        repaint();
+    }
+
+    void clear()
+    {
+        image.clear(image.getBounds(), juce::Colours::black);
+        writeColumn = 0;
+        repaint();
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        const int historyLength = image.getWidth();
+        const int numRows = image.getHeight();
+        const int olderColumns = historyLength - writeColumn; // From writeColumn to the end: the oldest frames
+
+        const float width = (float)getWidth();
+        const int splitX = juce::roundToInt(width * olderColumns / historyLength);
+
+        g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+
+        // Oldest frames on the left, newest on the right
+        g.drawImage(image, 0, 0, splitX, getHeight(), writeColumn, 0, olderColumns, numRows);
+
+        if (writeColumn > 0)
+            g.drawImage(image, splitX, 0, getWidth() - splitX, getHeight(), 0, 0, writeColumn, numRows);
+    }
+
+private:
+    static constexpr int colourTableSize = 256;
+
+    void buildColourTable()
+    {
+        // Black -> blue -> magenta -> red -> yellow -> white
+        juce::ColourGradient gradient(juce::Colours::black, 0.0f, 0.0f, juce::Colours::white, 1.0f, 0.0f, false);
+        gradient.addColour(0.2, juce::Colours::darkblue);
+        gradient.addColour(0.4, juce::Colours::magenta);
+        gradient.addColour(0.6, juce::Colours::red);
+        gradient.addColour(0.8, juce::Colours::yellow);
+
+        for (int i = 0; i < colourTableSize; ++i)
+            colourTable[i] = gradient.getColourAtPosition((double)i / (colourTableSize - 1));
+    }
+
+    juce::Image image;                           ///< historyLength x numRows, used as a ring of columns.
+    juce::Colour colourTable[colourTableSize];   ///< dB level -> colour.
+    int writeColumn = 0;                         ///< Column the next frame goes into.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrogramView)
+};
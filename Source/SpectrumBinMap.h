@@ -0,0 +1,192 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * SpectrumBinMap class that maps FFT bins onto the pixel columns of a log-frequency display.
+ * Bin i sits at x = width * log(i + 1) / log(fftSize). The map stores, per column, the range of
+ * bins landing in it, or for the sparse low-frequency columns that no bin lands in, the two
+ * neighbouring bins to interpolate between. The axis runs on to x = width, past the last bin at
+ * log(N/2) / log(N); columns out there hold no bin and reduce to 0. It is rebuilt only when the
+ * FFT size or width changes, so reducing a spectrum costs one pass over the bins plus one value per column.
+ *
+ * Other axes are built with build() from the span of fractional bins each column covers, which may
+ * also name one of several magnitude arrays to read, e.g. one per octave of a multi-rate analysis.
+ */
+class SpectrumBinMap
+{
+public:
+    enum class Reduction
+    {
+        peak = 0, // Loudest bin in the column
+        mean      // Average of the bins in the column
+    };
+
+    static constexpr int noSource = -1;
+
+    // The part of the bin axis one column covers, in fractional bins
+    struct ColumnSpan
+    {
+        double low = 0.0;    // Left edge: the column holds the bins i with low <= i < high
+        double high = 0.0;
+        double centre = 0.0; // Where to interpolate if no bin lies in [low, high)
+        int source = 0;      // Magnitude array the bins are read from, or noSource for an empty column
+    };
+
+    SpectrumBinMap() = default;
+
+    // Rebuilds the log-frequency map if the layout changed
+    void prepare(int _fftSize, int _numColumns)
+    {
+        assert(_fftSize >= 2 && _numColumns > 0);
+
+        if (_fftSize == fftSize && _numColumns == numColumns)
+            return;
+
+        const double logSize = std::log((double)_fftSize);
+        const int withBins = getNumColumnsWithBins(_fftSize, _numColumns);
+
+        // Bins i with c <= x(i) < c + 1
+        build(_numColumns, _fftSize / 2, [&](int c)
+        {
+            ColumnSpan span;
+            span.low = std::exp(logSize * c / _numColumns) - 1.0;
+            span.high = std::exp(logSize * (c + 1) / _numColumns) - 1.0;
+            span.centre = std::exp(logSize * (c + 0.5) / _numColumns) - 1.0;
+            span.source = c < withBins ? 0 : noSource;
+            return span;
+        });
+
+        fftSize = _fftSize;
+    }
+
+    // Rebuilds the map for numColumns columns over numBins bins from getSpan(c), which returns the
+    // ColumnSpan of column c. A later prepare() always rebuilds.
+    template <typename SpanFunction>
+    void build(int _numColumns, int numBins, SpanFunction&& getSpan)
+    {
+        assert(_numColumns > 0 && numBins >= 2);
+
+        fftSize = 0;
+        numColumns = _numColumns;
+        numColumnsWithBins = 0;
+        columns.resize(static_cast<size_t>(numColumns));
+
+        for (int c = 0; c < numColumns; ++c)
+        {
+            const ColumnSpan span = getSpan(c);
+            Column& column = columns[c];
+            column.source = span.source;
+            column.isEmpty = span.source == noSource;
+
+            if (column.isEmpty)
+                continue;
+
+            numColumnsWithBins = c + 1;
+            column.firstBin = std::clamp((int)std::ceil(span.low - 1e-9), 0, numBins);
+            column.lastBin = std::clamp((int)std::ceil(span.high - 1e-9), 0, numBins);
+
+            if (column.firstBin >= column.lastBin)
+            {
+                // No bin lands here: interpolate at the column centre
+                const double position = std::clamp(span.centre, 0.0, (double)(numBins - 1));
+                column.firstBin = std::min((int)position, numBins - 1);
+                column.lastBin = std::min(column.firstBin + 1, numBins - 1);
+                column.fraction = (float)(position - column.firstBin);
+                column.isInterpolated = true;
+            }
+            else
+            {
+                column.fraction = 0.0f;
+                column.isInterpolated = false;
+            }
+        }
+    }
+
+    // Reduces the magnitudes of the bins to getNumColumns() values
+    void reduce(const float* magnitudes, float* columnValues, Reduction reduction) const
+    {
+        reduce(&magnitudes, columnValues, reduction);
+    }
+
+    // Same, with each column read from sources[its ColumnSpan::source]
+    void reduce(const float* const* sources, float* columnValues, Reduction reduction) const
+    {
+        for (int c = 0; c < numColumns; ++c)
+        {
+            const Column& column = columns[c];
+
+            if (column.isEmpty)
+            {
+                columnValues[c] = 0.0f;
+                continue;
+            }
+
+            const float* magnitudes = sources[column.source];
+
+            if (column.isInterpolated)
+            {
+                const float a = magnitudes[column.firstBin];
+                const float b = magnitudes[column.lastBin];
+                columnValues[c] = a + column.fraction * (b - a);
+            }
+            else if (reduction == Reduction::peak)
+            {
+                columnValues[c] = *std::max_element(magnitudes + column.firstBin, magnitudes + column.lastBin);
+            }
+            else
+            {
+                float sum = 0.0f;
+                for (int i = column.firstBin; i < column.lastBin; ++i)
+                    sum += magnitudes[i];
+
+                columnValues[c] = sum / (float)(column.lastBin - column.firstBin);
+            }
+        }
+    }
+
+    // Horizontal position of a (possibly fractional) bin, on the same scale as the map
+    static float binToX(float bin, int fftSize, int width)
+    {
+        return width * std::log(bin + 1.0f) / std::log((float)fftSize);
+    }
+
+    // Leading columns of the axis that reach a bin; the ones to their right lie past the last bin
+    static int getNumColumnsWithBins(int fftSize, int numColumns)
+    {
+        const double logSize = std::log((double)fftSize);
+        const int numBins = fftSize / 2;
+
+        int c = 0;
+        while (c < numColumns && (int)std::ceil(std::exp(logSize * c / numColumns) - 1.0 - 1e-9) < numBins)
+            ++c;
+
+        return c;
+    }
+
+    int getFFTSize() const noexcept { return fftSize; }
+    int getNumColumns() const noexcept { return numColumns; }
+    int getNumColumnsWithBins() const noexcept { return numColumnsWithBins; }
+
+private:
+    struct Column
+    {
+        int firstBin = 0;      // First bin of the column, or left neighbour when interpolating
+        int lastBin = 0;       // One past the last bin, or right neighbour when interpolating
+        float fraction = 0.0f; // Interpolation weight of the right neighbour
+        bool isInterpolated = false;
+        int source = 0;        // Index into the sources given to reduce()
+        bool isEmpty = false;  // Past the last bin
+    };
+
+    std::vector<Column> columns;
+    int fftSize = 0;
+    int numColumns = 0;
+    int numColumnsWithBins = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumBinMap)
+};
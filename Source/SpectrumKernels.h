@@ -0,0 +1,637 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #define SPECTRUM_KERNELS_SSE 1
+ #include <immintrin.h>
+ #if defined (_MSC_VER) && ! defined (__clang__)
+  #define SPECTRUM_KERNELS_AVX2_TARGET
+ #else
+  #define SPECTRUM_KERNELS_AVX2_TARGET __attribute__ ((target ("avx2,fma")))
+ #endif
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__) || defined (_M_ARM64)
+ #define SPECTRUM_KERNELS_NEON 1
+ #include <arm_neon.h>
+#endif
+
+/**
+ * SpectrumKernels: vectorised building blocks for the spectrum analysis path.
+ * Magnitude and power of interleaved (re, im, re, im, ...) or split complex data,
+ * a fast decibel conversion built on a polynomial log2 (error below 0.002 dB), a
+ * branchless peak-hold/release pass over levels in dB, and an in-place attack/release
+ * smoother for power spectra.
+ * The implementation is chosen once at runtime: AVX2 when the CPU has it, otherwise
+ * SSE2 on x86, NEON on ARM, or plain scalar code. Simple element-wise steps such as
+ * clamping and range normalisation go through juce::FloatVectorOperations.
+ */
+class SpectrumKernels
+{
+public:
+    // out[i] = |c[i]| for numBins complex values stored interleaved
+    static void magnitudeInterleaved(const float* interleaved, float* out, int numBins)
+    {
+        getTable().magnitudeInterleaved(interleaved, out, numBins);
+    }
+
+    // out[i] = |c[i]|^2 for numBins complex values stored interleaved
+    static void powerInterleaved(const float* interleaved, float* out, int numBins)
+    {
+        getTable().powerInterleaved(interleaved, out, numBins);
+    }
+
+    // out[i] = sqrt(re[i]^2 + im[i]^2)
+    static void magnitudeSplit(const float* re, const float* im, float* out, int numBins)
+    {
+        getTable().magnitudeSplit(re, im, out, numBins);
+    }
+
+    // out[i] = re[i]^2 + im[i]^2
+    static void powerSplit(const float* re, const float* im, float* out, int numBins)
+    {
+        getTable().powerSplit(re, im, out, numBins);
+    }
+
+    // out[i] = max(20 * log10(in[i]), floorDecibels) for amplitude values
+    static void amplitudeToDecibels(const float* in, float* out, int num, float floorDecibels)
+    {
+        getTable().toDecibels(in, out, num, 20.0f, floorDecibels);
+    }
+
+    // out[i] = max(10 * log10(in[i]), floorDecibels) for power values
+    static void powerToDecibels(const float* in, float* out, int num, float floorDecibels)
+    {
+        getTable().toDecibels(in, out, num, 10.0f, floorDecibels);
+    }
+
+    // Peak hold with release, for num levels in dB, advanced by elapsedSeconds of audio.
+    // held[i] follows any level above it and restarts its hold timer, stays put for holdSeconds,
+    // then falls by releaseDecibelsPerSecond until the level catches it. timers[i] is the hold
+    // time left per value; start both arrays at the floor level and zero.
+    static void peakHold(const float* levels, float* held, float* timers, int num,
+                         float elapsedSeconds, float holdSeconds, float releaseDecibelsPerSecond)
+    {
+        getTable().peakHold(levels, held, timers, num, elapsedSeconds, holdSeconds, releaseDecibelsPerSecond);
+    }
+
+    // One-pole attack/release smoothing in place: average[i] moves towards power[i] by attackCoefficient
+    // of the gap when power is above it, by releaseCoefficient when below. Coefficients are in (0, 1].
+    static void smoothPower(const float* power, float* average, int num, float attackCoefficient, float releaseCoefficient)
+    {
+        getTable().smoothPower(power, average, num, attackCoefficient, releaseCoefficient);
+    }
+
+    // Maps [minValue, maxValue] linearly onto [0, 1], clamping whatever falls outside
+    static void normalise(float* data, int num, float minValue, float maxValue)
+    {
+        juce::FloatVectorOperations::add(data, -minValue, num);
+        juce::FloatVectorOperations::multiply(data, 1.0f / (maxValue - minValue), num);
+        juce::FloatVectorOperations::clip(data, data, 0.0f, 1.0f, num);
+    }
+
+    // Name of the implementation picked for this CPU, for diagnostics
+    static const char* getImplementationName()
+    {
+        return getTable().name;
+    }
+
+private:
+    struct Table
+    {
+        const char* name;
+        void (*magnitudeInterleaved)(const float*, float*, int);
+        void (*powerInterleaved)(const float*, float*, int);
+        void (*magnitudeSplit)(const float*, const float*, float*, int);
+        void (*powerSplit)(const float*, const float*, float*, int);
+        void (*toDecibels)(const float*, float*, int, float, float);
+        void (*peakHold)(const float*, float*, float*, int, float, float, float);
+        void (*smoothPower)(const float*, float*, int, float, float);
+    };
+
+    // Smallest value fed into the logarithm: keeps zeros and denormals out of the bit tricks
+    static constexpr float minimumLogInput = 1.0e-20f;
+
+    // log2(m) for m in [1, 2), as a polynomial in t = m - 1.5
+    static constexpr float log2c0 = 0.58495427f;
+    static constexpr float log2c1 = 0.96116786f;
+    static constexpr float log2c2 = -0.31991878f;
+    static constexpr float log2c3 = 0.15391848f;
+    static constexpr float log2c4 = -0.07915383f;
+
+    static constexpr float log10Of2 = 0.30102999566f;
+
+    static const Table& getTable()
+    {
+        static const Table table = selectTable();
+        return table;
+    }
+
+    static Table selectTable()
+    {
+       #if SPECTRUM_KERNELS_SSE
+        if (juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3())
+            return { "AVX2", Avx2::magnitudeInterleaved, Avx2::powerInterleaved, Avx2::magnitudeSplit, Avx2::powerSplit, Avx2::toDecibels, Avx2::peakHold,
+                     Avx2::smoothPower };
+
+        return { "SSE2", Sse::magnitudeInterleaved, Sse::powerInterleaved, Sse::magnitudeSplit, Sse::powerSplit, Sse::toDecibels, Sse::peakHold,
+                 Sse::smoothPower };
+       #elif SPECTRUM_KERNELS_NEON
+        return { "NEON", Neon::magnitudeInterleaved, Neon::powerInterleaved, Neon::magnitudeSplit, Neon::powerSplit, Neon::toDecibels, Neon::peakHold,
+                 Neon::smoothPower };
+       #else
+        return { "Scalar", Scalar::magnitudeInterleaved, Scalar::powerInterleaved, Scalar::magnitudeSplit, Scalar::powerSplit, Scalar::toDecibels, Scalar::peakHold,
+                 Scalar::smoothPower };
+       #endif
+    }
+
+    //==============================================================================
+    // Plain C++; also finishes the tails the vector versions leave over
+    struct Scalar
+    {
+        static void magnitudeInterleaved(const float* c, float* out, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                out[i] = std::sqrt(c[2 * i] * c[2 * i] + c[2 * i + 1] * c[2 * i + 1]);
+        }
+
+        static void powerInterleaved(const float* c, float* out, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                out[i] = c[2 * i] * c[2 * i] + c[2 * i + 1] * c[2 * i + 1];
+        }
+
+        static void magnitudeSplit(const float* re, const float* im, float* out, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                out[i] = std::sqrt(re[i] * re[i] + im[i] * im[i]);
+        }
+
+        static void powerSplit(const float* re, const float* im, float* out, int n)
+        {
+            for (int i = 0; i < n; ++i)
+                out[i] = re[i] * re[i] + im[i] * im[i];
+        }
+
+        static float fastLog2(float x)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+
+            const float exponent = (float)((int)(bits >> 23) - 127);
+            bits = (bits & 0x007FFFFFu) | 0x3F800000u;
+
+            float mantissa;
+            std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+            const float t = mantissa - 1.5f;
+            return exponent + (log2c0 + t * (log2c1 + t * (log2c2 + t * (log2c3 + t * log2c4))));
+        }
+
+        static void toDecibels(const float* in, float* out, int n, float multiplier, float floorDecibels)
+        {
+            const float scale = multiplier * log10Of2;
+
+            for (int i = 0; i < n; ++i)
+                out[i] = std::max(scale * fastLog2(std::max(in[i], minimumLogInput)), floorDecibels);
+        }
+
+        static void peakHold(const float* levels, float* held, float* timers, int n, float elapsed, float hold, float release)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                // Only the part of the elapsed time past the end of the hold releases
+                const float decay = release * std::min(std::max(elapsed - timers[i], 0.0f), elapsed);
+                const float decayed = held[i] - decay;
+                const bool isNewPeak = levels[i] >= decayed;
+
+                held[i] = isNewPeak ? levels[i] : decayed;
+                timers[i] = isNewPeak ? hold : std::max(timers[i] - elapsed, 0.0f);
+            }
+        }
+
+        static void smoothPower(const float* power, float* average, int n, float attack, float release)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                const float difference = power[i] - average[i];
+                average[i] += (difference > 0.0f ? attack : release) * difference;
+            }
+        }
+    };
+
+   #if SPECTRUM_KERNELS_SSE
+    //==============================================================================
+    struct Sse
+    {
+        static __m128 fastLog2(__m128 x)
+        {
+            const __m128i bits = _mm_castps_si128(x);
+            const __m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+            const __m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+            const __m128 t = _mm_sub_ps(mantissa, _mm_set1_ps(1.5f));
+            __m128 p = _mm_set1_ps(log2c4);
+            p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2c3));
+            p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2c2));
+            p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2c1));
+            p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(log2c0));
+            return _mm_add_ps(exponent, p);
+        }
+
+        static __m128 interleavedPower(const float* c)
+        {
+            const __m128 a = _mm_loadu_ps(c);
+            const __m128 b = _mm_loadu_ps(c + 4);
+            const __m128 re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            return _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+        }
+
+        static __m128 splitPower(const float* re, const float* im)
+        {
+            const __m128 r = _mm_loadu_ps(re);
+            const __m128 m = _mm_loadu_ps(im);
+            return _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m));
+        }
+
+        static void magnitudeInterleaved(const float* c, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, _mm_sqrt_ps(interleavedPower(c + 2 * i)));
+
+            Scalar::magnitudeInterleaved(c + 2 * i, out + i, n - i);
+        }
+
+        static void powerInterleaved(const float* c, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, interleavedPower(c + 2 * i));
+
+            Scalar::powerInterleaved(c + 2 * i, out + i, n - i);
+        }
+
+        static void magnitudeSplit(const float* re, const float* im, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, _mm_sqrt_ps(splitPower(re + i, im + i)));
+
+            Scalar::magnitudeSplit(re + i, im + i, out + i, n - i);
+        }
+
+        static void powerSplit(const float* re, const float* im, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+                _mm_storeu_ps(out + i, splitPower(re + i, im + i));
+
+            Scalar::powerSplit(re + i, im + i, out + i, n - i);
+        }
+
+        static void toDecibels(const float* in, float* out, int n, float multiplier, float floorDecibels)
+        {
+            const __m128 scale = _mm_set1_ps(multiplier * log10Of2);
+            const __m128 floorValue = _mm_set1_ps(floorDecibels);
+            const __m128 minimum = _mm_set1_ps(minimumLogInput);
+
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const __m128 x = _mm_max_ps(_mm_loadu_ps(in + i), minimum);
+                _mm_storeu_ps(out + i, _mm_max_ps(_mm_mul_ps(scale, fastLog2(x)), floorValue));
+            }
+
+            Scalar::toDecibels(in + i, out + i, n - i, multiplier, floorDecibels);
+        }
+
+        static void peakHold(const float* levels, float* held, float* timers, int n, float elapsed, float hold, float release)
+        {
+            const __m128 elapsedValue = _mm_set1_ps(elapsed);
+            const __m128 holdValue = _mm_set1_ps(hold);
+            const __m128 releaseValue = _mm_set1_ps(release);
+            const __m128 zero = _mm_setzero_ps();
+
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const __m128 level = _mm_loadu_ps(levels + i);
+                const __m128 timer = _mm_loadu_ps(timers + i);
+
+                const __m128 decay = _mm_mul_ps(releaseValue, _mm_min_ps(_mm_max_ps(_mm_sub_ps(elapsedValue, timer), zero), elapsedValue));
+                const __m128 decayed = _mm_sub_ps(_mm_loadu_ps(held + i), decay);
+                const __m128 isNewPeak = _mm_cmpge_ps(level, decayed);
+
+                // SSE2 has no blend: select with and/andnot/or
+                _mm_storeu_ps(held + i, _mm_or_ps(_mm_and_ps(isNewPeak, level), _mm_andnot_ps(isNewPeak, decayed)));
+                const __m128 counted = _mm_max_ps(_mm_sub_ps(timer, elapsedValue), zero);
+                _mm_storeu_ps(timers + i, _mm_or_ps(_mm_and_ps(isNewPeak, holdValue), _mm_andnot_ps(isNewPeak, counted)));
+            }
+
+            Scalar::peakHold(levels + i, held + i, timers + i, n - i, elapsed, hold, release);
+        }
+
+        static void smoothPower(const float* power, float* average, int n, float attack, float release)
+        {
+            const __m128 attackValue = _mm_set1_ps(attack);
+            const __m128 releaseValue = _mm_set1_ps(release);
+            const __m128 zero = _mm_setzero_ps();
+
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const __m128 current = _mm_loadu_ps(average + i);
+                const __m128 difference = _mm_sub_ps(_mm_loadu_ps(power + i), current);
+                const __m128 isRising = _mm_cmpgt_ps(difference, zero);
+                const __m128 coefficient = _mm_or_ps(_mm_and_ps(isRising, attackValue), _mm_andnot_ps(isRising, releaseValue));
+
+                _mm_storeu_ps(average + i, _mm_add_ps(current, _mm_mul_ps(coefficient, difference)));
+            }
+
+            Scalar::smoothPower(power + i, average + i, n - i, attack, release);
+        }
+    };
+
+    //==============================================================================
+    struct Avx2
+    {
+        SPECTRUM_KERNELS_AVX2_TARGET static __m256 fastLog2(__m256 x)
+        {
+            const __m256i bits = _mm256_castps_si256(x);
+            const __m256 exponent = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+            const __m256 mantissa = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+            const __m256 t = _mm256_sub_ps(mantissa, _mm256_set1_ps(1.5f));
+            __m256 p = _mm256_set1_ps(log2c4);
+            p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2c3));
+            p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2c2));
+            p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2c1));
+            p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(log2c0));
+            return _mm256_add_ps(exponent, p);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static __m256 interleavedPower(const float* c)
+        {
+            const __m256 a = _mm256_loadu_ps(c);
+            const __m256 b = _mm256_loadu_ps(c + 8);
+
+            // The in-lane shuffles leave the 128-bit halves as (a.lo, b.lo, a.hi, b.hi): restore order
+            const __m256 reShuffled = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m256 imShuffled = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            const __m256 re = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(reShuffled), _MM_SHUFFLE(3, 1, 2, 0)));
+            const __m256 im = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(imShuffled), _MM_SHUFFLE(3, 1, 2, 0)));
+
+            return _mm256_fmadd_ps(re, re, _mm256_mul_ps(im, im));
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static __m256 splitPower(const float* re, const float* im)
+        {
+            const __m256 r = _mm256_loadu_ps(re);
+            const __m256 m = _mm256_loadu_ps(im);
+            return _mm256_fmadd_ps(r, r, _mm256_mul_ps(m, m));
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void magnitudeInterleaved(const float* c, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, _mm256_sqrt_ps(interleavedPower(c + 2 * i)));
+
+            Sse::magnitudeInterleaved(c + 2 * i, out + i, n - i);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void powerInterleaved(const float* c, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, interleavedPower(c + 2 * i));
+
+            Sse::powerInterleaved(c + 2 * i, out + i, n - i);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void magnitudeSplit(const float* re, const float* im, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, _mm256_sqrt_ps(splitPower(re + i, im + i)));
+
+            Sse::magnitudeSplit(re + i, im + i, out + i, n - i);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void powerSplit(const float* re, const float* im, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(out + i, splitPower(re + i, im + i));
+
+            Sse::powerSplit(re + i, im + i, out + i, n - i);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void toDecibels(const float* in, float* out, int n, float multiplier, float floorDecibels)
+        {
+            const __m256 scale = _mm256_set1_ps(multiplier * log10Of2);
+            const __m256 floorValue = _mm256_set1_ps(floorDecibels);
+            const __m256 minimum = _mm256_set1_ps(minimumLogInput);
+
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m256 x = _mm256_max_ps(_mm256_loadu_ps(in + i), minimum);
+                _mm256_storeu_ps(out + i, _mm256_max_ps(_mm256_mul_ps(scale, fastLog2(x)), floorValue));
+            }
+
+            Sse::toDecibels(in + i, out + i, n - i, multiplier, floorDecibels);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void peakHold(const float* levels, float* held, float* timers, int n, float elapsed, float hold, float release)
+        {
+            const __m256 elapsedValue = _mm256_set1_ps(elapsed);
+            const __m256 holdValue = _mm256_set1_ps(hold);
+            const __m256 releaseValue = _mm256_set1_ps(release);
+            const __m256 zero = _mm256_setzero_ps();
+
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m256 level = _mm256_loadu_ps(levels + i);
+                const __m256 timer = _mm256_loadu_ps(timers + i);
+
+                const __m256 decay = _mm256_mul_ps(releaseValue, _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(elapsedValue, timer), zero), elapsedValue));
+                const __m256 decayed = _mm256_sub_ps(_mm256_loadu_ps(held + i), decay);
+                const __m256 isNewPeak = _mm256_cmp_ps(level, decayed, _CMP_GE_OQ);
+
+                _mm256_storeu_ps(held + i, _mm256_blendv_ps(decayed, level, isNewPeak));
+                _mm256_storeu_ps(timers + i, _mm256_blendv_ps(_mm256_max_ps(_mm256_sub_ps(timer, elapsedValue), zero), holdValue, isNewPeak));
+            }
+
+            Sse::peakHold(levels + i, held + i, timers + i, n - i, elapsed, hold, release);
+        }
+
+        SPECTRUM_KERNELS_AVX2_TARGET static void smoothPower(const float* power, float* average, int n, float attack, float release)
+        {
+            const __m256 attackValue = _mm256_set1_ps(attack);
+            const __m256 releaseValue = _mm256_set1_ps(release);
+            const __m256 zero = _mm256_setzero_ps();
+
+            int i = 0;
+            for (; i + 8 <= n; i += 8)
+            {
+                const __m256 current = _mm256_loadu_ps(average + i);
+                const __m256 difference = _mm256_sub_ps(_mm256_loadu_ps(power + i), current);
+                const __m256 coefficient = _mm256_blendv_ps(releaseValue, attackValue, _mm256_cmp_ps(difference, zero, _CMP_GT_OQ));
+
+                _mm256_storeu_ps(average + i, _mm256_fmadd_ps(coefficient, difference, current));
+            }
+
+            Sse::smoothPower(power + i, average + i, n - i, attack, release);
+        }
+    };
+   #endif
+
+   #if SPECTRUM_KERNELS_NEON
+    //==============================================================================
+    struct Neon
+    {
+        static float32x4_t fastLog2(float32x4_t x)
+        {
+            const uint32x4_t bits = vreinterpretq_u32_f32(x);
+            const float32x4_t exponent = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), vdupq_n_s32(127)));
+            const float32x4_t mantissa = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, vdupq_n_u32(0x007FFFFF)), vdupq_n_u32(0x3F800000)));
+
+            const float32x4_t t = vsubq_f32(mantissa, vdupq_n_f32(1.5f));
+            float32x4_t p = vdupq_n_f32(log2c4);
+            p = vmlaq_f32(vdupq_n_f32(log2c3), p, t);
+            p = vmlaq_f32(vdupq_n_f32(log2c2), p, t);
+            p = vmlaq_f32(vdupq_n_f32(log2c1), p, t);
+            p = vmlaq_f32(vdupq_n_f32(log2c0), p, t);
+            return vaddq_f32(exponent, p);
+        }
+
+        static float32x4_t sqrt(float32x4_t x)
+        {
+           #if defined (__aarch64__) || defined (_M_ARM64)
+            return vsqrtq_f32(x);
+           #else
+            // Reciprocal square root estimate plus two Newton steps; zero stays zero
+            float32x4_t estimate = vrsqrteq_f32(vmaxq_f32(x, vdupq_n_f32(1.0e-30f)));
+            estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(x, estimate), estimate));
+            estimate = vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(x, estimate), estimate));
+            return vmulq_f32(x, estimate);
+           #endif
+        }
+
+        static void magnitudeInterleaved(const float* c, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4x2_t v = vld2q_f32(c + 2 * i);
+                vst1q_f32(out + i, sqrt(vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1])));
+            }
+
+            Scalar::magnitudeInterleaved(c + 2 * i, out + i, n - i);
+        }
+
+        static void powerInterleaved(const float* c, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4x2_t v = vld2q_f32(c + 2 * i);
+                vst1q_f32(out + i, vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]));
+            }
+
+            Scalar::powerInterleaved(c + 2 * i, out + i, n - i);
+        }
+
+        static void magnitudeSplit(const float* re, const float* im, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4_t r = vld1q_f32(re + i);
+                const float32x4_t m = vld1q_f32(im + i);
+                vst1q_f32(out + i, sqrt(vmlaq_f32(vmulq_f32(r, r), m, m)));
+            }
+
+            Scalar::magnitudeSplit(re + i, im + i, out + i, n - i);
+        }
+
+        static void powerSplit(const float* re, const float* im, float* out, int n)
+        {
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4_t r = vld1q_f32(re + i);
+                const float32x4_t m = vld1q_f32(im + i);
+                vst1q_f32(out + i, vmlaq_f32(vmulq_f32(r, r), m, m));
+            }
+
+            Scalar::powerSplit(re + i, im + i, out + i, n - i);
+        }
+
+        static void toDecibels(const float* in, float* out, int n, float multiplier, float floorDecibels)
+        {
+            const float32x4_t scale = vdupq_n_f32(multiplier * log10Of2);
+            const float32x4_t floorValue = vdupq_n_f32(floorDecibels);
+            const float32x4_t minimum = vdupq_n_f32(minimumLogInput);
+
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4_t x = vmaxq_f32(vld1q_f32(in + i), minimum);
+                vst1q_f32(out + i, vmaxq_f32(vmulq_f32(scale, fastLog2(x)), floorValue));
+            }
+
+            Scalar::toDecibels(in + i, out + i, n - i, multiplier, floorDecibels);
+        }
+
+        static void peakHold(const float* levels, float* held, float* timers, int n, float elapsed, float hold, float release)
+        {
+            const float32x4_t elapsedValue = vdupq_n_f32(elapsed);
+            const float32x4_t holdValue = vdupq_n_f32(hold);
+            const float32x4_t releaseValue = vdupq_n_f32(release);
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4_t level = vld1q_f32(levels + i);
+                const float32x4_t timer = vld1q_f32(timers + i);
+
+                const float32x4_t decay = vmulq_f32(releaseValue, vminq_f32(vmaxq_f32(vsubq_f32(elapsedValue, timer), zero), elapsedValue));
+                const float32x4_t decayed = vsubq_f32(vld1q_f32(held + i), decay);
+                const uint32x4_t isNewPeak = vcgeq_f32(level, decayed);
+
+                vst1q_f32(held + i, vbslq_f32(isNewPeak, level, decayed));
+                vst1q_f32(timers + i, vbslq_f32(isNewPeak, holdValue, vmaxq_f32(vsubq_f32(timer, elapsedValue), zero)));
+            }
+
+            Scalar::peakHold(levels + i, held + i, timers + i, n - i, elapsed, hold, release);
+        }
+
+        static void smoothPower(const float* power, float* average, int n, float attack, float release)
+        {
+            const float32x4_t attackValue = vdupq_n_f32(attack);
+            const float32x4_t releaseValue = vdupq_n_f32(release);
+            const float32x4_t zero = vdupq_n_f32(0.0f);
+
+            int i = 0;
+            for (; i + 4 <= n; i += 4)
+            {
+                const float32x4_t current = vld1q_f32(average + i);
+                const float32x4_t difference = vsubq_f32(vld1q_f32(power + i), current);
+                const float32x4_t coefficient = vbslq_f32(vcgtq_f32(difference, zero), attackValue, releaseValue);
+
+                vst1q_f32(average + i, vmlaq_f32(current, coefficient, difference));
+            }
+
+            Scalar::smoothPower(power + i, average + i, n - i, attack, release);
+        }
+    };
+   #endif
+};
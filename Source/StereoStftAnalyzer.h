@@ -0,0 +1,230 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "AlignedBuffer.h"
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "WindowTables.h"
+#include "SpectrumKernels.h"
+#include "WelchAverage.h"
+
+/**
+ * StereoStftAnalyzer class: left, right, mid and side spectra of a stereo pair from one transform per frame.
+ * Each windowed frame is packed into one complex signal z = L + iR and transformed with a single
+ * complex FFT. Since L and R are real, their spectra follow from the conjugate symmetry of Z:
+ * L[k] = (Z[k] + Z*[N-k]) / 2 and R[k] = (Z[k] - Z*[N-k]) / 2i. Mid and side, (L + R) / 2 and
+ * (L - R) / 2, are then combined bin by bin in the frequency domain. Four spectra cost about as
+ * much as two real transforms, instead of four. Frames are hop-spaced and Welch-averaged like
+ * in StftAnalyzer.
+ *
+ * The two channels may come from different rings, e.g. an input channel and a sidechain reference,
+ * as long as both rings count positions from the same start.
+ */
+class StereoStftAnalyzer
+{
+public:
+    enum Spectrum { left = 0, right, mid, side, numSpectra };
+
+    struct Config
+    {
+        int frameOrder = 12;          // Frame size is 2^frameOrder samples
+        int hopSize = 1024;           // Samples between the starts of consecutive frames
+        WindowType window = WindowType::hann;
+        int numFramesAveraged = 1;    // Frames combined into the long-window estimate
+        int leftChannel = 0;
+        int rightChannel = 1;         // In the left channel's ring unless process() is given another
+        bool withMidSide = true;      // Without, only the left and right spectra are formed and averaged
+
+        bool operator==(const Config& other) const
+        {
+            return frameOrder == other.frameOrder && hopSize == other.hopSize && window == other.window
+                && numFramesAveraged == other.numFramesAveraged && leftChannel == other.leftChannel
+                && rightChannel == other.rightChannel && withMidSide == other.withMidSide;
+        }
+
+        bool operator!=(const Config& other) const { return ! (*this == other); }
+    };
+
+    StereoStftAnalyzer() = default;
+
+    // Applies a new configuration; the averaged history restarts if anything changed
+    void configure(const Config& newConfig)
+    {
+        assert(newConfig.hopSize > 0 && newConfig.numFramesAveraged > 0);
+
+        if (newConfig == config && isPrepared)
+            return;
+
+        config = newConfig;
+        welch.prepare(config.numFramesAveraged, getNumSpectra() * getNumBins());
+        isPrepared = true;
+        nextFrameEnd = static_cast<uint64_t>(getFrameSize());
+    }
+
+    // Transforms every complete frame of both channels that arrived since the last call. Returns the number of new frames.
+    int process(const CircularBuffer& buffer, FFTEngine& fftEngine)
+    {
+        return process(buffer, buffer, fftEngine);
+    }
+
+    // Same, with the right channel read from its own ring
+    int process(const CircularBuffer& leftBuffer, const CircularBuffer& rightBuffer, FFTEngine& fftEngine)
+    {
+        const int frameSize = getFrameSize();
+        const int capacity = std::min(leftBuffer.getCapacity(), rightBuffer.getCapacity());
+
+        // The audio thread pushes the channels one after the other, so the right one can lag a block behind
+        const uint64_t writePosition = std::min(leftBuffer.getWritePosition(config.leftChannel), rightBuffer.getWritePosition(config.rightChannel));
+
+        if (writePosition < nextFrameEnd || frameSize > capacity)
+            return 0;
+
+        const uint64_t hop = static_cast<uint64_t>(config.hopSize);
+        const uint64_t lookBack = std::min(hop * (config.numFramesAveraged - 1) + frameSize, static_cast<uint64_t>(capacity));
+        if (writePosition - nextFrameEnd > lookBack - frameSize)
+            nextFrameEnd += ((writePosition - nextFrameEnd - (lookBack - frameSize)) + hop - 1) / hop * hop;
+
+        int numFrames = 0;
+        for (; nextFrameEnd <= writePosition; nextFrameEnd += hop)
+        {
+            if (transformFrame(leftBuffer, rightBuffer, fftEngine, nextFrameEnd))
+                ++numFrames;
+        }
+
+        return numFrames;
+    }
+
+    // Writes the averaged magnitude of each of the getNumBins() bins of one spectrum, on the scale of an unwindowed transform
+    void getMagnitudes(Spectrum spectrum, float* magnitudes) const
+    {
+        assert(spectrum < getNumSpectra() && "Mid and side were not formed");
+        const int numBins = getNumBins();
+        welch.getMagnitudes(static_cast<int>(spectrum) * numBins, numBins, 1.0f / windowGain, magnitudes);
+    }
+
+    int getFrameSize() const noexcept { return 1 << config.frameOrder; }
+    int getNumBins() const noexcept { return getFrameSize() / 2; }
+    int getNumSpectra() const noexcept { return config.withMidSide ? numSpectra : 2; }
+    const Config& getConfig() const noexcept { return config; }
+
+private:
+    bool transformFrame(const CircularBuffer& leftBuffer, const CircularBuffer& rightBuffer, FFTEngine& fftEngine, uint64_t frameEnd)
+    {
+        const int frameSize = getFrameSize();
+        const int numBins = getNumBins();
+        const WindowTables::Table& window = windows.get(config.window, config.frameOrder);
+
+        frameLeft.ensureSize(frameSize);
+        frameRight.ensureSize(frameSize);
+
+        if (! leftBuffer.copyEndingAt(frameEnd, frameSize, config.leftChannel, frameLeft.get())
+            || ! rightBuffer.copyEndingAt(frameEnd, frameSize, config.rightChannel, frameRight.get()))
+            return false; // Already overwritten: the analysis fell too far behind
+
+        // w * (L + iR), interleaved; a plan of order + 1 transforms frameSize complex points.
+        // The workspace holds twice that, so the transform runs out of place into its upper half.
+        float* packed = fftEngine.getInputBuffer(config.frameOrder + 1);
+        float* z = packed + 2 * frameSize;
+        const float* coefficients = window.coefficients.data();
+
+        for (int n = 0; n < frameSize; ++n)
+        {
+            packed[2 * n] = frameLeft[n] * coefficients[n];
+            packed[2 * n + 1] = frameRight[n] * coefficients[n];
+        }
+
+        fftEngine.getPlan(config.frameOrder + 1).performComplexForward(packed, z);
+        windowGain = window.coherentGain;
+
+        // Replace the oldest power spectra in the average
+        float* row = welch.beginFrame();
+
+        if (config.withMidSide)
+        {
+            separate(z, numBins);
+
+            for (int s = 0; s < numSpectra; ++s)
+                SpectrumKernels::powerSplit(real.get() + s * numBins, imag.get() + s * numBins, row + s * numBins, numBins);
+        }
+        else
+        {
+            separatePowers(z, numBins, row, row + numBins);
+        }
+
+        welch.endFrame();
+        return true;
+    }
+
+    // Left and right power of bins 0..numBins-1 straight from the packed spectrum, without storing the bins
+    static void separatePowers(const float* z, int numBins, float* leftPower, float* rightPower)
+    {
+        const int frameSize = 2 * numBins;
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            const int mirror = (frameSize - k) & (frameSize - 1);
+            const float zr = z[2 * k], zi = z[2 * k + 1];
+            const float mr = z[2 * mirror], mi = z[2 * mirror + 1];
+
+            leftPower[k] = 0.25f * ((zr + mr) * (zr + mr) + (zi - mi) * (zi - mi));
+            rightPower[k] = 0.25f * ((zi + mi) * (zi + mi) + (mr - zr) * (mr - zr));
+        }
+    }
+
+    // Splits the packed spectrum into split-complex left, right, mid and side bins 0..numBins-1
+    void separate(const float* z, int numBins)
+    {
+        const int frameSize = 2 * numBins;
+        real.ensureSize(numSpectra * numBins);
+        imag.ensureSize(numSpectra * numBins);
+
+        float* leftRe = real.get();
+        float* leftIm = imag.get();
+        float* rightRe = leftRe + numBins;
+        float* rightIm = leftIm + numBins;
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            const int mirror = (frameSize - k) & (frameSize - 1); // N - k, and 0 for k = 0
+            const float zr = z[2 * k], zi = z[2 * k + 1];
+            const float mr = z[2 * mirror], mi = z[2 * mirror + 1];
+
+            leftRe[k] = 0.5f * (zr + mr);
+            leftIm[k] = 0.5f * (zi - mi);
+            rightRe[k] = 0.5f * (zi + mi);
+            rightIm[k] = 0.5f * (mr - zr);
+        }
+
+        // Mid and side from left and right: plain element-wise passes
+        float* midRe = rightRe + numBins;
+        float* midIm = rightIm + numBins;
+        float* sideRe = midRe + numBins;
+        float* sideIm = midIm + numBins;
+
+        juce::FloatVectorOperations::add(midRe, leftRe, rightRe, numBins);
+        juce::FloatVectorOperations::add(midIm, leftIm, rightIm, numBins);
+        juce::FloatVectorOperations::subtract(sideRe, leftRe, rightRe, numBins);
+        juce::FloatVectorOperations::subtract(sideIm, leftIm, rightIm, numBins);
+
+        // Mid and side sit next to each other in both arrays, so one pass each halves them
+        juce::FloatVectorOperations::multiply(midRe, 0.5f, 2 * numBins);
+        juce::FloatVectorOperations::multiply(midIm, 0.5f, 2 * numBins);
+    }
+
+    Config config;
+    WindowTables windows;
+    AlignedBuffer<float> frameLeft, frameRight;
+    AlignedBuffer<float> real, imag; ///< Split-complex bins of the four spectra, numBins each, in Spectrum order.
+
+    WelchAverage welch;           ///< Rows of getNumSpectra() per-bin power spectra, side by side.
+    bool isPrepared = false;      ///< False until configure() sized the average.
+    uint64_t nextFrameEnd = 0;    ///< Position both channels must reach for the next frame to be complete.
+    float windowGain = 1.0f;      ///< Coherent gain of the window in use.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StereoStftAnalyzer)
+};
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include "AlignedBuffer.h"
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "WindowTables.h"
+#include "SpectrumKernels.h"
+#include "WelchAverage.h"
+
+// How the power spectra of consecutive frames are combined
+enum class SpectrumAveraging
+{
+    linear = 0,  // Mean of the last numFramesAveraged frames: a sliding window
+    exponential  // One-pole smoothing per bin with attack and release time constants
+};
+
+/**
+ * StftAnalyzer class for a streaming, hop-based spectrum estimate.
+ * As new samples land in the capture ring it transforms fixed-size windowed frames,
+ * one every hop. With linear averaging it keeps the power spectra of the last
+ * numFramesAveraged frames, and their mean (Welch's method) stands in for one long-window
+ * transform. With exponential averaging each frame instead moves one running power per bin
+ * by a fraction set by the attack or release time constant, in place, so smoothing over
+ * seconds needs neither a history of frames nor audio beyond the latest ones.
+ * Either way the cost of a display frame scales with the amount of new audio rather than
+ * the averaging time.
+ */
+class StftAnalyzer
+{
+public:
+    struct Config
+    {
+        int frameOrder = 12;          // Frame size is 2^frameOrder samples
+        int hopSize = 1024;           // Samples between the starts of consecutive frames
+        WindowType window = WindowType::hann;
+        int numFramesAveraged = 1;    // Frames in the linear average; with exponential, most frames caught up on at once
+        int channel = 0;
+        SpectrumAveraging averaging = SpectrumAveraging::linear;
+        int sampleRate = 48000;       // Only used to turn the time constants into per-frame coefficients
+        float attackSeconds = 0.0f;   // Exponential time constant while the power rises; 0 follows at once
+        float releaseSeconds = 0.5f;  // Exponential time constant while the power falls
+
+        bool operator==(const Config& other) const
+        {
+            return hasSameEstimate(other) && numFramesAveraged == other.numFramesAveraged
+                && sampleRate == other.sampleRate && attackSeconds == other.attackSeconds && releaseSeconds == other.releaseSeconds;
+        }
+
+        bool operator!=(const Config& other) const { return ! (*this == other); }
+
+        // True if an estimate built with other can carry on under this configuration
+        bool hasSameEstimate(const Config& other) const
+        {
+            return frameOrder == other.frameOrder && hopSize == other.hopSize && window == other.window
+                && channel == other.channel && averaging == other.averaging
+                && (averaging == SpectrumAveraging::exponential || numFramesAveraged == other.numFramesAveraged);
+        }
+    };
+
+    StftAnalyzer() = default;
+
+    // Applies a new configuration. The averaged history restarts if the estimate changed; new time
+    // constants of an exponential average apply from the next frame on.
+    void configure(const Config& newConfig)
+    {
+        assert(newConfig.hopSize > 0 && newConfig.numFramesAveraged > 0);
+
+        if (newConfig == config && isPrepared)
+            return;
+
+        const bool keepsEstimate = newConfig.hasSameEstimate(config) && isPrepared;
+        config = newConfig;
+
+        attackCoefficient = getCoefficient(config.attackSeconds);
+        releaseCoefficient = getCoefficient(config.releaseSeconds);
+
+        if (keepsEstimate)
+            return;
+
+        const int numBins = getNumBins();
+        const bool isLinear = config.averaging == SpectrumAveraging::linear;
+
+        // Only the kind of average in use holds any memory
+        welch.prepare(isLinear ? config.numFramesAveraged : 1, isLinear ? numBins : 0);
+        average.ensureSize(isLinear ? 0 : numBins);
+        framePower.ensureSize(isLinear ? 0 : numBins);
+
+        hasAverage = false;
+        numSkippedFrames = 0;
+        nextFrameEnd = static_cast<uint64_t>(getFrameSize());
+        isPrepared = true;
+    }
+
+    // Forgets the averaged history, e.g. when the ring it reads from starts over at position zero
+    void reset()
+    {
+        isPrepared = false; // Makes the next configure() start from scratch
+    }
+
+    // Transforms every complete frame that arrived since the last call. Returns the number of new frames.
+    int process(const CircularBuffer& buffer, FFTEngine& fftEngine)
+    {
+        const int frameSize = getFrameSize();
+        const uint64_t writePosition = buffer.getWritePosition(config.channel);
+
+        if (writePosition < nextFrameEnd || frameSize > buffer.getCapacity())
+            return 0;
+
+        // Frames older than what the average keeps, or than the ring still holds, are not worth transforming
+        const uint64_t hop = static_cast<uint64_t>(config.hopSize);
+        const uint64_t lookBack = std::min(hop * (config.numFramesAveraged - 1) + frameSize, static_cast<uint64_t>(buffer.getCapacity()));
+        if (writePosition - nextFrameEnd > lookBack - frameSize)
+        {
+            const uint64_t numSkipped = ((writePosition - nextFrameEnd - (lookBack - frameSize)) + hop - 1) / hop;
+            nextFrameEnd += numSkipped * hop;
+            numSkippedFrames += numSkipped;
+        }
+
+        int numFrames = 0;
+        for (; nextFrameEnd <= writePosition; nextFrameEnd += hop)
+        {
+            if (transformFrame(buffer, fftEngine, nextFrameEnd))
+                ++numFrames;
+            else
+                ++numSkippedFrames;
+        }
+
+        return numFrames;
+    }
+
+    // Writes the averaged magnitude of each of the getNumBins() bins, on the scale of an unwindowed transform
+    void getMagnitudes(float* magnitudes) const
+    {
+        const int numBins = getNumBins();
+        const float gain = 1.0f / windowGain;
+
+        if (config.averaging == SpectrumAveraging::linear)
+        {
+            welch.getMagnitudes(0, numBins, gain, magnitudes);
+            return;
+        }
+
+        if (! hasAverage)
+        {
+            juce::FloatVectorOperations::clear(magnitudes, numBins);
+            return;
+        }
+
+        for (int i = 0; i < numBins; ++i)
+            magnitudes[i] = gain * std::sqrt(average[i]);
+    }
+
+    int getFrameSize() const noexcept { return 1 << config.frameOrder; }
+    int getNumBins() const noexcept { return getFrameSize() / 2; }
+    const Config& getConfig() const noexcept { return config; }
+
+private:
+    bool transformFrame(const CircularBuffer& buffer, FFTEngine& fftEngine, uint64_t frameEnd)
+    {
+        const int frameSize = getFrameSize();
+        const int numBins = getNumBins();
+        const WindowTables::Table& window = windows.get(config.window, config.frameOrder);
+        float* data = fftEngine.getInputBuffer(config.frameOrder);
+
+        // Window the frame straight out of the ring
+        bool isComplete = false;
+        for (int attempt = 0; attempt < CircularBuffer::maxReadAttempts && ! isComplete; ++attempt)
+        {
+            const CircularBuffer::Snapshot snapshot = buffer.getSnapshotEndingAt(frameEnd, frameSize, config.channel);
+            if (snapshot.size() < frameSize)
+                return false; // Already overwritten: the analysis fell too far behind
+
+            const float* coefficients = window.coefficients.data();
+            juce::FloatVectorOperations::multiply(data, snapshot.head, coefficients, snapshot.headSize);
+            juce::FloatVectorOperations::multiply(data + snapshot.headSize, snapshot.tail, coefficients + snapshot.headSize, snapshot.tailSize);
+
+            isComplete = buffer.isValid(snapshot);
+        }
+
+        if (! isComplete)
+            return false;
+
+        fftEngine.getPlan(config.frameOrder).performRealForward(data);
+        windowGain = window.coherentGain;
+
+        if (config.averaging == SpectrumAveraging::exponential)
+        {
+            // The first frame starts the average; after that, one in-place pass over the bins
+            SpectrumKernels::powerInterleaved(data, hasAverage ? framePower.get() : average.get(), numBins);
+
+            // Hops skipped since the last frame count as frames with this one's power, so the time
+            // constants hold however far the analysis fell behind
+            if (hasAverage)
+            {
+                const uint64_t numFrames = numSkippedFrames + 1;
+                SpectrumKernels::smoothPower(framePower.get(), average.get(), numBins,
+                                             getCatchUpCoefficient(attackCoefficient, numFrames),
+                                             getCatchUpCoefficient(releaseCoefficient, numFrames));
+            }
+
+            numSkippedFrames = 0;
+            hasAverage = true;
+            return true;
+        }
+
+        // Replace the oldest power spectrum in the average
+        SpectrumKernels::powerInterleaved(data, welch.beginFrame(), numBins);
+        welch.endFrame();
+        return true;
+    }
+
+    // Fraction of the gap to the new power a frame covers, for a time constant in seconds
+    float getCoefficient(float seconds) const
+    {
+        if (seconds <= 0.0f || config.sampleRate <= 0)
+            return 1.0f;
+
+        return static_cast<float>(1.0 - std::exp(-config.hopSize / (static_cast<double>(seconds) * config.sampleRate)));
+    }
+
+    // The coefficient of numFrames identical frames folded in at once: 1 - (1 - c)^numFrames
+    static float getCatchUpCoefficient(float coefficient, uint64_t numFrames)
+    {
+        if (numFrames == 1)
+            return coefficient;
+
+        return static_cast<float>(1.0 - std::pow(1.0 - static_cast<double>(coefficient), static_cast<double>(numFrames)));
+    }
+
+    Config config;
+    WindowTables windows;
+    bool isPrepared = false;      ///< False until configure() sized the estimate, and after reset().
+
+    WelchAverage welch;           ///< Linear: the last numFramesAveraged power spectra and their sum.
+    bool hasAverage = false;      ///< Exponential: true once the first frame started the average.
+    AlignedBuffer<float> average;    ///< Exponential: smoothed per-bin power.
+    AlignedBuffer<float> framePower; ///< Exponential: power of the frame being folded in.
+    float attackCoefficient = 1.0f;
+    float releaseCoefficient = 1.0f;
+    uint64_t nextFrameEnd = 0;    ///< Ring write position at which the next frame is complete.
+    uint64_t numSkippedFrames = 0; ///< Exponential: hops passed over since the last frame folded in.
+    float windowGain = 1.0f;      ///< Coherent gain of the window in use.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StftAnalyzer)
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+/**
+ * TripleBuffer class for handing the latest value from one producer thread to one consumer thread.
+ * Neither side ever waits: the producer fills its private slot and swaps it into the shared
+ * middle slot, the consumer swaps the middle slot out whenever it holds something newer.
+ * Intermediate values the consumer never picked up are simply dropped.
+ * @tparam T - The value type; slots are reused, so T's own storage is recycled between frames.
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    // Producer side: the slot to fill before calling publish()
+    T& getWriteBuffer() noexcept { return slots[writeIndex]; }
+
+    // Producer side: makes the write buffer the latest value and takes over a free slot
+    void publish() noexcept
+    {
+        const int previous = middle.exchange(writeIndex | newDataFlag, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    // Consumer side: moves to the latest published value. Returns false if nothing new arrived.
+    bool update() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & newDataFlag) == 0)
+            return false;
+
+        const int previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    // Consumer side: the value picked up by the last update()
+    const T& getReadBuffer() const noexcept { return slots[readIndex]; }
+
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    T slots[3];
+    int writeIndex = 0;           ///< Owned by the producer.
+    std::atomic<int> middle { 1 }; ///< Shared slot index, plus newDataFlag when unread.
+    int readIndex = 2;            ///< Owned by the consumer.
+
+    JUCE_DECLARE_NON_COPYABLE(TripleBuffer)
+};
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include "CircularBuffer.h"
+
+/**
+ * WaveformPyramid class that keeps a multi-level min/max/RMS summary of one captured channel.
+ * Level 0 summarises blocks of baseBlockSize samples, each further level combines levelFactor
+ * entries of the level below. The summary is updated incrementally by the audio thread in push()
+ * without locks, and every level is a single-producer/single-consumer ring like CircularBuffer.
+ * A waveform view can then draw any time span from the level that matches its pixel width,
+ * touching O(width) entries instead of every sample.
+ */
+class WaveformPyramid
+{
+public:
+    static constexpr int baseBlockSize = 16;
+    static constexpr int levelFactor = 4;
+    static constexpr int numLevels = 8;
+
+    // Every level holds entriesPerLevel entries, so higher levels reach much further back in time
+    explicit WaveformPyramid(int _entriesPerLevel)
+        : entriesPerLevel(_entriesPerLevel)
+    {
+        assert(entriesPerLevel > 0 && "Each level must hold at least one entry");
+
+        for (auto& level : levels)
+        {
+            level.mins.resize(static_cast<size_t>(entriesPerLevel), 0.0f);
+            level.maxs.resize(static_cast<size_t>(entriesPerLevel), 0.0f);
+            level.sumSquares.resize(static_cast<size_t>(entriesPerLevel), 0.0f);
+        }
+    }
+
+    static int getBlockSize(int level) { return baseBlockSize << (2 * level); }
+
+    // Producer side: folds new samples into the summary. Only call from the thread pushing the channel.
+    void push(const float* data, int numSamples)
+    {
+        for (int i = 0; i < numSamples;)
+        {
+            // Accumulate as much of the current level-0 block as this push provides
+            const int count = std::min(numSamples - i, baseBlockSize - blockFill);
+
+            for (int j = 0; j < count; ++j)
+            {
+                const float sample = data[i + j];
+                blockMin = std::min(blockMin, sample);
+                blockMax = std::max(blockMax, sample);
+                blockSumSquares += sample * sample;
+            }
+
+            i += count;
+            blockFill += count;
+
+            if (blockFill == baseBlockSize)
+            {
+                emit(0, blockMin, blockMax, blockSumSquares);
+                resetBlock();
+            }
+        }
+    }
+
+    /**
+     * Consumer side: summarises the most recent numSamples into numColumns columns, oldest first.
+     * Columns older than the captured history come back flat at zero.
+     * Spans too short for level 0 (fewer than baseBlockSize samples per column) are read from the raw ring.
+     */
+    void getColumns(const CircularBuffer& ring, int channel, int numSamples, int numColumns, float* mins, float* maxs, float* rms) const
+    {
+        assert(numColumns > 0 && numSamples > 0);
+
+        const double samplesPerColumn = static_cast<double>(numSamples) / numColumns;
+
+        if (samplesPerColumn < baseBlockSize)
+        {
+            getColumnsFromRing(ring, channel, numSamples, numColumns, mins, maxs, rms);
+            return;
+        }
+
+        // Pick the coarsest level that still has at least one entry per column
+        int levelIndex = 0;
+        while (levelIndex + 1 < numLevels && getBlockSize(levelIndex + 1) <= samplesPerColumn)
+            ++levelIndex;
+
+        const Level& level = levels[levelIndex];
+        const int blockSize = getBlockSize(levelIndex);
+        const int numEntries = std::min(entriesPerLevel - 1, (numSamples + blockSize - 1) / blockSize);
+
+        for (int attempt = 0; attempt < CircularBuffer::maxReadAttempts; ++attempt)
+        {
+            const uint64_t end = level.written.load(std::memory_order_acquire);
+            const uint64_t start = end >= static_cast<uint64_t>(numEntries) ? end - numEntries : 0;
+
+            for (int column = 0; column < numColumns; ++column)
+            {
+                // Entries [first, last) of the requested span fall into this column
+                const int64_t first = static_cast<int64_t>(end) - numEntries + static_cast<int64_t>(column) * numEntries / numColumns;
+                const int64_t last = std::max(first + 1, static_cast<int64_t>(end) - numEntries + static_cast<int64_t>(column + 1) * numEntries / numColumns);
+
+                float columnMin = 0.0f, columnMax = 0.0f, columnSumSquares = 0.0f;
+                bool isFirst = true;
+
+                for (int64_t entry = std::max<int64_t>(first, static_cast<int64_t>(start)); entry < last; ++entry)
+                {
+                    const size_t index = static_cast<size_t>(entry % entriesPerLevel);
+                    columnMin = isFirst ? level.mins[index] : std::min(columnMin, level.mins[index]);
+                    columnMax = isFirst ? level.maxs[index] : std::max(columnMax, level.maxs[index]);
+                    columnSumSquares += level.sumSquares[index];
+                    isFirst = false;
+                }
+
+                mins[column] = columnMin;
+                maxs[column] = columnMax;
+                rms[column] = std::sqrt(columnSumSquares / static_cast<float>((last - first) * blockSize));
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (level.pending.load(std::memory_order_relaxed) <= start + static_cast<uint64_t>(entriesPerLevel))
+                return;
+        }
+    }
+
+private:
+    struct Level
+    {
+        std::vector<float> mins, maxs, sumSquares; ///< Ring of summary entries.
+        std::atomic<uint64_t> written { 0 };       ///< Entries published so far.
+        std::atomic<uint64_t> pending { 0 };       ///< End of the entry the producer is currently writing.
+
+        // Producer-only accumulation of the next entry from entries of the level below
+        float partialMin = 0.0f, partialMax = 0.0f, partialSumSquares = 0.0f;
+        int partialCount = 0;
+    };
+
+    void emit(int levelIndex, float entryMin, float entryMax, float entrySumSquares)
+    {
+        Level& level = levels[levelIndex];
+        const uint64_t position = level.written.load(std::memory_order_relaxed);
+        const size_t index = static_cast<size_t>(position % static_cast<uint64_t>(entriesPerLevel));
+
+        level.pending.store(position + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        level.mins[index] = entryMin;
+        level.maxs[index] = entryMax;
+        level.sumSquares[index] = entrySumSquares;
+        level.written.store(position + 1, std::memory_order_release);
+
+        if (levelIndex + 1 == numLevels)
+            return;
+
+        // Fold the entry into the next level up
+        Level& parent = levels[levelIndex + 1];
+        parent.partialMin = parent.partialCount == 0 ? entryMin : std::min(parent.partialMin, entryMin);
+        parent.partialMax = parent.partialCount == 0 ? entryMax : std::max(parent.partialMax, entryMax);
+        parent.partialSumSquares = (parent.partialCount == 0 ? 0.0f : parent.partialSumSquares) + entrySumSquares;
+
+        if (++parent.partialCount == levelFactor)
+        {
+            parent.partialCount = 0;
+            emit(levelIndex + 1, parent.partialMin, parent.partialMax, parent.partialSumSquares);
+        }
+    }
+
+    void resetBlock()
+    {
+        blockMin = std::numeric_limits<float>::max();
+        blockMax = std::numeric_limits<float>::lowest();
+        blockSumSquares = 0.0f;
+        blockFill = 0;
+    }
+
+    static void getColumnsFromRing(const CircularBuffer& ring, int channel, int numSamples, int numColumns, float* mins, float* maxs, float* rms)
+    {
+        for (int attempt = 0; attempt < CircularBuffer::maxReadAttempts; ++attempt)
+        {
+            const CircularBuffer::Snapshot snapshot = ring.getSnapshot(numSamples, channel);
+            const int missing = numSamples - snapshot.size();
+
+            for (int column = 0; column < numColumns; ++column)
+            {
+                const int first = static_cast<int>(static_cast<int64_t>(column) * numSamples / numColumns);
+                const int last = std::max(first + 1, static_cast<int>(static_cast<int64_t>(column + 1) * numSamples / numColumns));
+
+                float columnMin = 0.0f, columnMax = 0.0f, columnSumSquares = 0.0f;
+                bool isFirst = true;
+
+                for (int i = std::max(first, missing); i < last; ++i)
+                {
+                    const float sample = snapshot[i - missing];
+                    columnMin = isFirst ? sample : std::min(columnMin, sample);
+                    columnMax = isFirst ? sample : std::max(columnMax, sample);
+                    columnSumSquares += sample * sample;
+                    isFirst = false;
+                }
+
+                mins[column] = columnMin;
+                maxs[column] = columnMax;
+                rms[column] = std::sqrt(columnSumSquares / static_cast<float>(last - first));
+            }
+
+            if (ring.isValid(snapshot))
+                return;
+        }
+    }
+
+    Level levels[numLevels];
+    int entriesPerLevel;
+
+    // Producer-only accumulation of the current level-0 block
+    float blockMin = std::numeric_limits<float>::max();
+    float blockMax = std::numeric_limits<float>::lowest();
+    float blockSumSquares = 0.0f;
+    int blockFill = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WaveformPyramid)
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * WelchAverage class: the sliding mean of the power spectra of the last numFrames frames.
+ * Each frame's per-bin power is written into a row of a history ring; a running per-bin sum
+ * drops the row being replaced and adds the new one, so folding in a frame and reading the
+ * average each cost one pass over the values, however many frames are averaged. A row may
+ * hold several spectra side by side, e.g. left, right, mid and side of one transform.
+ */
+class WelchAverage
+{
+public:
+    WelchAverage() = default;
+
+    // Sizes the history for numFrames rows of numValues powers and empties it
+    void prepare(int _numFrames, int _numValues)
+    {
+        assert(_numFrames > 0 && _numValues >= 0);
+
+        numFrames = _numFrames;
+        numValues = _numValues;
+        history.assign(static_cast<size_t>(numFrames) * numValues, 0.0f);
+        powerSum.assign(static_cast<size_t>(numValues), 0.0);
+        historyWrite = 0;
+        historyCount = 0;
+    }
+
+    // Row for the next frame's powers; the oldest frame leaves the sum once the history is full.
+    // Fill it, then call endFrame().
+    float* beginFrame()
+    {
+        float* row = history.data() + static_cast<size_t>(historyWrite) * numValues;
+
+        if (historyCount == numFrames)
+        {
+            for (int i = 0; i < numValues; ++i)
+                powerSum[i] -= row[i];
+        }
+
+        return row;
+    }
+
+    // Adds the row handed out by beginFrame() to the sum
+    void endFrame()
+    {
+        const float* row = history.data() + static_cast<size_t>(historyWrite) * numValues;
+
+        for (int i = 0; i < numValues; ++i)
+            powerSum[i] += row[i];
+
+        historyWrite = (historyWrite + 1) % numFrames;
+        historyCount = std::min(historyCount + 1, numFrames);
+    }
+
+    // Writes gain * sqrt(mean power) of the values first..first + count - 1; zeros before the first frame
+    void getMagnitudes(int first, int count, float gain, float* magnitudes) const
+    {
+        assert(first >= 0 && first + count <= numValues);
+
+        if (historyCount == 0)
+        {
+            juce::FloatVectorOperations::clear(magnitudes, count);
+            return;
+        }
+
+        const double scale = 1.0 / historyCount;
+        const double* sum = powerSum.data() + first;
+
+        for (int i = 0; i < count; ++i)
+            magnitudes[i] = gain * static_cast<float>(std::sqrt(std::max(0.0, sum[i] * scale)));
+    }
+
+    int getNumFrames() const noexcept { return historyCount; }
+    bool isEmpty() const noexcept { return historyCount == 0; }
+
+private:
+    std::vector<float> history;   ///< numFrames rows of numValues powers, used as a ring.
+    std::vector<double> powerSum; ///< Running per-value sum of the rows currently in the history.
+    int numFrames = 1;
+    int numValues = 0;
+    int historyWrite = 0;         ///< Row the next frame goes into.
+    int historyCount = 0;         ///< Number of valid rows.
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WelchAverage)
+};
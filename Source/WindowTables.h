@@ -0,0 +1,76 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cmath>
+
+enum class WindowType
+{
+    hann = 0,
+    blackmanHarris,
+    flatTop,
+    numWindowTypes
+};
+
+/**
+ * WindowTables class that precomputes analysis windows once per type and power-of-two size.
+ * Tables are periodic (suited to overlapped FFT frames) and come with their coherent gain,
+ * so callers can undo the window's amplitude loss.
+ */
+class WindowTables
+{
+public:
+    static constexpr int maxOrder = 24;
+
+    struct Table
+    {
+        std::vector<float> coefficients;
+        float coherentGain = 1.0f; // Mean of the coefficients
+    };
+
+    // Returns the window of 2^order points, computing it on first use
+    const Table& get(WindowType type, int order)
+    {
+        assert(order >= 0 && order <= maxOrder && "Window order out of range");
+
+        auto& table = tables[static_cast<int>(type)][order];
+        if (table == nullptr)
+            table = build(type, 1 << order);
+
+        return *table;
+    }
+
+private:
+    static std::unique_ptr<Table> build(WindowType type, int size)
+    {
+        // Cosine-sum windows: w[n] = a0 - a1 cos(x) + a2 cos(2x) - a3 cos(3x) + a4 cos(4x)
+        static const double hann[] = { 0.5, 0.5, 0.0, 0.0, 0.0 };
+        static const double blackmanHarris[] = { 0.35875, 0.48829, 0.14128, 0.01168, 0.0 };
+        static const double flatTop[] = { 0.21557895, 0.41663158, 0.277263158, 0.083578947, 0.006947368 };
+
+        const double* a = type == WindowType::hann ? hann
+                        : type == WindowType::blackmanHarris ? blackmanHarris
+                        : flatTop;
+
+        auto table = std::make_unique<Table>();
+        table->coefficients.resize(static_cast<size_t>(size));
+
+        double sum = 0.0;
+        for (int n = 0; n < size; ++n)
+        {
+            const double x = 2.0 * juce::MathConstants<double>::pi * n / size;
+            const double w = a[0] - a[1] * std::cos(x) + a[2] * std::cos(2.0 * x) - a[3] * std::cos(3.0 * x) + a[4] * std::cos(4.0 * x);
+            table->coefficients[n] = static_cast<float>(w);
+            sum += w;
+        }
+
+        table->coherentGain = static_cast<float>(sum / size);
+        return table;
+    }
+
+    std::unique_ptr<Table> tables[static_cast<int>(WindowType::numWindowTypes)][maxOrder + 1];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WindowTables)
+};
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include <memory>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "AlignedBuffer.h"
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "WindowTables.h"
+#include "HalfBandDecimator.h"
+#include "SpectrumKernels.h"
+#include "SpectrumBinMap.h"
+#include "WelchAverage.h"
+
+/**
+ * ZoomFFTAnalyzer class: a high-resolution spectrum of one narrow band.
+ * New samples of the capture ring are mixed down with a complex oscillator at the band centre,
+ * low-passed and decimated by 2^k through half-band stages on both the I and Q paths until the
+ * rate is just wide enough for the span, and collected in a two-channel baseband ring. Complex
+ * FFTs of frameSize points over that ring are Welch-averaged like in StftAnalyzer. The bins are
+ * sampleRate / 2^k / frameSize apart, so a 4096-point transform resolves a 200 Hz band at 48 kHz
+ * to under 0.1 Hz, where a full-band FFT would need about 2^19 points.
+ */
+class ZoomFFTAnalyzer
+{
+public:
+    static constexpr int frameOrder = 12;         ///< Complex points per transform.
+    static constexpr int maxInputBlock = 1024;    ///< Ring samples mixed and decimated at a time.
+    static constexpr int maxStages = 16;
+
+    struct Config
+    {
+        int sampleRate = 0;
+        double centreFrequency = 1000.0;
+        double span = 200.0;            // Width of the band shown, centred on centreFrequency
+        double averagingSeconds = 0.5;  // Length of the Welch average
+        WindowType window = WindowType::hann;
+        int channel = 0;
+
+        bool operator==(const Config& other) const
+        {
+            return sampleRate == other.sampleRate && centreFrequency == other.centreFrequency && span == other.span
+                && averagingSeconds == other.averagingSeconds && window == other.window && channel == other.channel;
+        }
+
+        bool operator!=(const Config& other) const { return ! (*this == other); }
+    };
+
+    ZoomFFTAnalyzer() = default;
+
+    // Applies a new configuration; the baseband and the average restart if anything changed
+    void configure(const Config& newConfig)
+    {
+        if (newConfig == config && baseband != nullptr)
+            return;
+
+        config = newConfig;
+        baseband.reset();
+        decimatorsI.clear();
+        decimatorsQ.clear();
+        columnMapWidth = 0;
+        hasReadPosition = false;
+
+        if (config.sampleRate <= 0 || config.span <= 0.0)
+            return;
+
+        numStages = getNumStages(config);
+        rate = (double)config.sampleRate / (1 << numStages);
+        numFramesAveraged = getNumFramesAveraged(config);
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            const int inputSize = juce::jmax(1, maxInputBlock >> stage);
+            decimatorsI.push_back(std::make_unique<HalfBandDecimator>(inputSize));
+            decimatorsQ.push_back(std::make_unique<HalfBandDecimator>(inputSize));
+        }
+
+        blockI.assign(maxInputBlock, 0.0f);
+        blockQ.assign(maxInputBlock, 0.0f);
+        baseband = std::make_unique<CircularBuffer>(2, getFrameSize() + getHopSize() * (numFramesAveraged - 1) + maxInputBlock);
+
+        welch.prepare(numFramesAveraged, getFrameSize());
+        nextFrameEnd = (uint64_t)getFrameSize();
+    }
+
+    // Mixes and decimates everything the capture ring received since the last call, then
+    // transforms the baseband frames that completed
+    void process(const CircularBuffer& buffer, FFTEngine& fftEngine)
+    {
+        if (baseband == nullptr)
+            return;
+
+        const uint64_t writePosition = buffer.getWritePosition(config.channel);
+        const uint64_t capacity = (uint64_t)buffer.getCapacity();
+
+        if (! hasReadPosition || readPosition > writePosition || writePosition - readPosition > capacity)
+        {
+            readPosition = writePosition - std::min(writePosition, capacity);
+            hasReadPosition = true;
+        }
+
+        while (readPosition < writePosition)
+        {
+            const int numSamples = (int)std::min<uint64_t>(maxInputBlock, writePosition - readPosition);
+
+            if (buffer.copyEndingAt(readPosition + (uint64_t)numSamples, numSamples, config.channel, blockI.data()))
+                feed(readPosition, numSamples);
+
+            readPosition += (uint64_t)numSamples;
+        }
+
+        // Skip frames older than what the average keeps
+        const uint64_t basebandPosition = baseband->getWritePosition(0);
+        const uint64_t hop = (uint64_t)getHopSize();
+        const uint64_t lookBack = hop * (numFramesAveraged - 1);
+        if (basebandPosition >= nextFrameEnd && basebandPosition - nextFrameEnd > lookBack)
+            nextFrameEnd += (basebandPosition - nextFrameEnd - lookBack + hop - 1) / hop * hop;
+
+        for (; nextFrameEnd <= basebandPosition; nextFrameEnd += hop)
+            transformFrame(fftEngine, nextFrameEnd);
+    }
+
+    // Writes the averaged magnitude at numColumns columns spread linearly over the band,
+    // on the scale of an unwindowed real transform of frameSize points
+    void getColumns(int numColumns, float* columnValues)
+    {
+        if (baseband == nullptr || welch.isEmpty())
+        {
+            juce::FloatVectorOperations::clear(columnValues, numColumns);
+            return;
+        }
+
+        prepareColumns(numColumns);
+
+        // Bins in natural order are 0..N/2-1 above the centre and N/2..N-1 below it; lowest frequency first here
+        const int frameSize = getFrameSize();
+        const float gain = 1.0f / windowGain;
+        magnitudes.resize(static_cast<size_t>(frameSize));
+
+        welch.getMagnitudes(frameSize / 2, frameSize / 2, gain, magnitudes.data());
+        welch.getMagnitudes(0, frameSize / 2, gain, magnitudes.data() + frameSize / 2);
+
+        binMap.reduce(magnitudes.data(), columnValues, SpectrumBinMap::Reduction::peak);
+    }
+
+    static constexpr int getFrameSize() { return 1 << frameOrder; }
+    static constexpr int getHopSize() { return getFrameSize() / 2; }
+
+    // Input samples that still affect the estimate
+    static uint64_t getSpanSamples(const Config& config)
+    {
+        if (config.sampleRate <= 0 || config.span <= 0.0)
+            return 0;
+
+        const uint64_t span = (uint64_t)getFrameSize() + (uint64_t)getHopSize() * (getNumFramesAveraged(config) - 1);
+        return (span + 2 * (uint64_t)HalfBandDecimator::getLatency()) << getNumStages(config);
+    }
+
+    // Frequencies at the left edge of the first column and the right edge of the last one
+    static double getLowFrequency(const Config& config) { return config.centreFrequency - 0.5 * config.span; }
+    static double getHighFrequency(const Config& config) { return config.centreFrequency + 0.5 * config.span; }
+
+private:
+    // Halves the rate while the alias-free part of the next rate still holds the whole band
+    static int getNumStages(const Config& config)
+    {
+        int stages = 0;
+        while (stages < maxStages && HalfBandDecimator::passbandEdge * config.sampleRate / (2 << stages) >= 0.5 * config.span)
+            ++stages;
+
+        return stages;
+    }
+
+    static int getNumFramesAveraged(const Config& config)
+    {
+        const double basebandRate = (double)config.sampleRate / (1 << getNumStages(config));
+        return juce::jmax(1, (int)(basebandRate * config.averagingSeconds) / getHopSize());
+    }
+
+    // Mixes blockI (holding numSamples ring samples from position on) down to baseband and decimates it
+    void feed(uint64_t position, int numSamples)
+    {
+        // Oscillator phase from the absolute position, so skipped blocks do not shift it
+        const double omega = -2.0 * juce::MathConstants<double>::pi * config.centreFrequency / config.sampleRate;
+        const double phase = std::fmod(omega * (double)position, 2.0 * juce::MathConstants<double>::pi);
+        const double stepCos = std::cos(omega), stepSin = std::sin(omega);
+        double oscCos = std::cos(phase), oscSin = std::sin(phase);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float sample = blockI[i];
+            blockI[i] = sample * (float)oscCos;
+            blockQ[i] = sample * (float)oscSin;
+
+            const double nextCos = oscCos * stepCos - oscSin * stepSin;
+            oscSin = oscCos * stepSin + oscSin * stepCos;
+            oscCos = nextCos;
+        }
+
+        // Decimators copy their input before writing, so every stage can work in place
+        for (int stage = 0; stage < numStages && numSamples > 0; ++stage)
+        {
+            const int numOut = decimatorsI[stage]->process(blockI.data(), numSamples, blockI.data());
+            decimatorsQ[stage]->process(blockQ.data(), numSamples, blockQ.data());
+            numSamples = numOut;
+        }
+
+        if (numSamples > 0)
+        {
+            baseband->push(blockI.data(), numSamples, 0);
+            baseband->push(blockQ.data(), numSamples, 1);
+        }
+    }
+
+    void transformFrame(FFTEngine& fftEngine, uint64_t frameEnd)
+    {
+        const int frameSize = getFrameSize();
+        const WindowTables::Table& window = windows.get(config.window, frameOrder);
+
+        frameI.ensureSize(frameSize);
+        frameQ.ensureSize(frameSize);
+        spectrum.ensureSize(2 * frameSize);
+
+        // This thread writes the baseband ring itself, so the copies cannot tear
+        if (! baseband->copyEndingAt(frameEnd, frameSize, 0, frameI.get()) || ! baseband->copyEndingAt(frameEnd, frameSize, 1, frameQ.get()))
+            return;
+
+        float* input = fftEngine.getInputBuffer(frameOrder + 1);
+        for (int i = 0; i < frameSize; ++i)
+        {
+            input[2 * i] = frameI.get()[i] * window.coefficients[i];
+            input[2 * i + 1] = frameQ.get()[i] * window.coefficients[i];
+        }
+
+        // A plan of order + 1 transforms frameSize complex points; out of place, which every backend supports
+        float* data = spectrum.get();
+        fftEngine.getPlan(frameOrder + 1).performComplexForward(input, data);
+        windowGain = window.coherentGain;
+
+        SpectrumKernels::powerInterleaved(data, welch.beginFrame(), frameSize);
+        welch.endFrame();
+    }
+
+    // Column c covers [low + c * width, low + (c + 1) * width) of the band
+    void prepareColumns(int numColumns)
+    {
+        if (numColumns == columnMapWidth)
+            return;
+
+        columnMapWidth = numColumns;
+
+        const int frameSize = getFrameSize();
+        const double hertzPerBin = rate / frameSize;
+        const double columnWidth = config.span / numColumns;
+
+        // Index i of the reordered magnitudes sits at centre + (i - N/2) * hertzPerBin
+        auto toIndex = [&](double frequency) { return (frequency - config.centreFrequency) / hertzPerBin + frameSize / 2; };
+
+        binMap.build(numColumns, frameSize, [&](int c)
+        {
+            const double low = getLowFrequency(config) + c * columnWidth;
+
+            SpectrumBinMap::ColumnSpan span;
+            span.low = toIndex(low);
+            span.high = toIndex(low + columnWidth);
+            span.centre = toIndex(low + 0.5 * columnWidth);
+            return span;
+        });
+    }
+
+    Config config;
+    int numStages = 0;
+    double rate = 0.0;                ///< Baseband sample rate.
+    int numFramesAveraged = 1;
+
+    std::vector<std::unique_ptr<HalfBandDecimator>> decimatorsI, decimatorsQ;
+    std::vector<float> blockI, blockQ; ///< One block on its way through the mixer and the cascade.
+    std::unique_ptr<CircularBuffer> baseband; ///< Channel 0 = I, channel 1 = Q, at the baseband rate.
+    uint64_t readPosition = 0;        ///< Capture ring position mixed down so far.
+    bool hasReadPosition = false;
+
+    WindowTables windows;
+    AlignedBuffer<float> frameI, frameQ, spectrum;
+    WelchAverage welch;               ///< The last numFramesAveraged per-bin power spectra and their sum.
+    std::vector<float> magnitudes;    ///< Averaged magnitudes, lowest frequency first.
+    uint64_t nextFrameEnd = 0;        ///< Baseband write position at which the next frame is complete.
+    float windowGain = 1.0f;
+
+    SpectrumBinMap binMap;            ///< Columns spread linearly over the band.
+    int columnMapWidth = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ZoomFFTAnalyzer)
+};
@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    Checks that a steady-state display frame makes no heap allocation.
+    Run with "Benchmarks --test". Every malloc, calloc, realloc and aligned
+    allocation of the calling thread is counted, so growth of juce::Path,
+    juce::Array, HeapBlock and AlignedBuffer shows up as well as operator new.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+#include "AudioVisualizationProcessor.h"
+#include "FrameArena.h"
+
+namespace
+{
+    thread_local bool isCounting = false;
+    thread_local int allocationCount = 0;
+
+    void noteAllocation() noexcept
+    {
+        if (isCounting)
+            ++allocationCount;
+    }
+}
+
+//==============================================================================
+// Malloc-level hooks. glibc lets the executable interpose the allocator; the debug CRT on Windows
+// reports every heap call to an allocation hook. Elsewhere the check is skipped.
+#if JUCE_LINUX && defined(__GLIBC__)
+ #define FRAME_ALLOCATION_COUNTER_SUPPORTED 1
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+
+    void* malloc(size_t size)                      { noteAllocation(); return __libc_malloc(size); }
+    void* calloc(size_t count, size_t size)        { noteAllocation(); return __libc_calloc(count, size); }
+    void* realloc(void* pointer, size_t size)      { noteAllocation(); return __libc_realloc(pointer, size); }
+    void* memalign(size_t alignment, size_t size)  { noteAllocation(); return __libc_memalign(alignment, size); }
+    void* aligned_alloc(size_t alignment, size_t size) { noteAllocation(); return __libc_memalign(alignment, size); }
+
+    int posix_memalign(void** pointer, size_t alignment, size_t size)
+    {
+        noteAllocation();
+
+        if (void* block = __libc_memalign(alignment, size))
+        {
+            *pointer = block;
+            return 0;
+        }
+
+        return ENOMEM;
+    }
+}
+
+namespace { void installAllocationHook() {} }
+
+#elif JUCE_WINDOWS && JUCE_DEBUG
+ #define FRAME_ALLOCATION_COUNTER_SUPPORTED 1
+ #include <crtdbg.h>
+
+namespace
+{
+    int countAllocations(int allocType, void*, size_t, int, long, const unsigned char*, int)
+    {
+        if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+            noteAllocation();
+
+        return TRUE;
+    }
+
+    void installAllocationHook()
+    {
+        static const bool isInstalled = (_CrtSetAllocHook(countAllocations), true);
+        juce::ignoreUnused(isInstalled);
+    }
+}
+
+#else
+ #define FRAME_ALLOCATION_COUNTER_SUPPORTED 0
+
+namespace { void installAllocationHook() {} }
+#endif
+
+namespace
+{
+    // Counts the heap allocations of the calling thread for the lifetime of the object
+    class ScopedAllocationCount
+    {
+    public:
+        ScopedAllocationCount() noexcept
+        {
+            installAllocationHook();
+            allocationCount = 0;
+            isCounting = true;
+        }
+
+        ~ScopedAllocationCount() noexcept { isCounting = false; }
+
+        int get() const noexcept { return allocationCount; }
+
+    private:
+        JUCE_DECLARE_NON_COPYABLE(ScopedAllocationCount)
+    };
+}
+
+//==============================================================================
+/**
+ * One editor frame, as SpectrumAnalyzerAudioProcessorEditor::timerCallback() runs it: the audio of one
+ * timer tick is pushed, analysed, and turned into the waveform path and every spectrum row, with the
+ * editor's view sizes, path preallocation and arena size.
+ */
+class FrameAllocationTests : public juce::UnitTest
+{
+public:
+    FrameAllocationTests() : juce::UnitTest("Frame allocations", "Realtime") {}
+
+    void runTest() override
+    {
+        if (! FRAME_ALLOCATION_COUNTER_SUPPORTED)
+        {
+            logMessage("No malloc-level allocation counter on this platform and configuration, skipped");
+            return;
+        }
+
+        beginTest("One spectrum row");
+        expectFramesDoNotAllocate(1, false);
+
+        beginTest("Overlay of every channel");
+        expectFramesDoNotAllocate(maxSpectrumRows, true);
+
+        beginTest("Left/right/mid/side");
+        expectFramesDoNotAllocate(2, false, true);
+    }
+
+private:
+    static constexpr int sampleRate = 48000;
+    static constexpr int framesPerSecond = 30;           ///< VISUAL_FRAMERATE of the editor.
+    static constexpr int waveformWidth = 800;            ///< VISUALIZER_WIDTH.
+    static constexpr int waveformHeight = 150;           ///< VISUALIZER_HEIGHT.
+    static constexpr int spectrumWidth = 200;            ///< SPECTRUM_WIDTH.
+    static constexpr int spectrumHeight = 250;           ///< SPECTRUM_HEIGHT.
+    static constexpr int maxSpectrumRows = 16;           ///< MAX_SPECTRUM_ROWS, one per captured channel.
+    static constexpr int numWarmUpFrames = 8;
+    static constexpr int numCheckedFrames = 90;
+
+    void expectFramesDoNotAllocate(int numChannels, bool overlayChannels, bool stereoMidSide = false)
+    {
+        constexpr int samplesPerFrame = sampleRate / framesPerSecond;
+
+        AnalysisSettings settings;
+        settings.waveformSamples = 20000;
+        settings.waveformColumns = waveformWidth;
+        settings.spectrumColumns = spectrumWidth;
+        settings.peakHoldMode = 1;
+        settings.overlayChannels = overlayChannels;
+        settings.stereoMidSide = stereoMidSide;
+
+        AudioVisualizationProcessor processor;
+        processor.prepare(sampleRate, numChannels, samplesPerFrame, settings);
+
+        FrameArena arena((2 * waveformWidth + maxSpectrumRows * spectrumWidth) * (int)sizeof(float) + (2 + maxSpectrumRows) * (int)FrameArena::alignment);
+        juce::Path waveformPath;
+        waveformPath.preallocateSpace(waveformWidth * AudioVisualizationProcessor::coordinatesPerSegment);
+
+        std::vector<juce::Path> spectrumPaths((size_t)maxSpectrumRows);
+        for (auto& path : spectrumPaths)
+            path.preallocateSpace((spectrumWidth + 1) * AudioVisualizationProcessor::coordinatesPerSegment);
+
+        std::vector<float> block((size_t)samplesPerFrame);
+        juce::Random random(42);
+        AnalysisResult result;
+
+        auto runFrame = [&]
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                for (auto& sample : block)
+                    sample = random.nextFloat() - 0.5f;
+
+                processor.pushAudioData(block.data(), samplesPerFrame, channel);
+            }
+
+            processor.analyse(settings, result);
+
+            arena.reset();
+            AudioVisualizationProcessor::buildVisualizationPath(result, waveformHeight, waveformWidth, arena, waveformPath);
+
+            for (int row = 0; row < result.numSpectrumChannels; ++row)
+                AudioVisualizationProcessor::buildSpectrumPath(result, spectrumHeight, spectrumWidth, arena, spectrumPaths[(size_t)row], row);
+        };
+
+        const int arenaCapacity = arena.getCapacity();
+
+        for (int frame = 0; frame < numWarmUpFrames; ++frame)
+            runFrame();
+
+        // An overflow would be allocated inside the editor's checked section on the first frame
+        expectEquals(arena.getCapacity(), arenaCapacity, "Arena capacity after the first frames");
+
+        const int expectedRows = stereoMidSide ? 4 : overlayChannels ? numChannels : 1;
+        expectEquals(result.numSpectrumChannels, expectedRows, "Rows of the analysed spectrum");
+
+        int numAllocations = 0;
+        {
+            ScopedAllocationCount count;
+
+            for (int frame = 0; frame < numCheckedFrames; ++frame)
+                runFrame();
+
+            numAllocations = count.get();
+        }
+
+        expectEquals(numAllocations, 0, "Heap allocations in " + juce::String(numCheckedFrames) + " steady-state frames");
+    }
+};
+
+static FrameAllocationTests frameAllocationTests;
@@ -0,0 +1,617 @@
+/*
+  ==============================================================================
+
+    Micro-benchmarks for the capture and analysis hot paths.
+    Runs headless; results go to stdout as a table, CSV or JSON.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "SpectrumKernels.h"
+#include "AudioVisualizationProcessor.h"
+
+namespace
+{
+    constexpr int captureCapacity = 80000; // About the history the plugin's default settings capture at 48 kHz
+
+    struct Result
+    {
+        juce::String name;          // Function under test
+        juce::String parameters;    // Case parameters, "key=value" separated by spaces
+        juce::int64 operations = 0; // Operations timed
+        double nsPerOp = 0.0;       // Mean
+        double p50 = 0.0;           // Median ns/op over batches
+        double p99 = 0.0;           // 99th percentile ns/op over batches
+        double itemsPerSecond = 0.0;
+        juce::String unit;          // What itemsPerSecond counts
+    };
+
+    double ticksToSeconds(juce::int64 ticks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(ticks);
+    }
+
+    /**
+     * Times op() until minSeconds have been spent in it.
+     * Operations run in batches long enough (about 2 us) for the clock overhead not to matter;
+     * percentiles are over per-batch means, so they describe batch-to-batch jitter, not single calls.
+     */
+    template <typename Operation>
+    Result measure(const juce::String& name, const juce::String& parameters, double itemsPerOp, const juce::String& unit,
+                   double minSeconds, Operation&& op)
+    {
+        auto timeBatch = [&op](int batchSize)
+        {
+            const juce::int64 start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < batchSize; ++i)
+                op();
+            return ticksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        };
+
+        // Warm up caches and lazily built tables, then size the batch
+        int batchSize = 1;
+        while (timeBatch(batchSize) < 2.0e-6 && batchSize < (1 << 20))
+            batchSize *= 2;
+
+        std::vector<double> batchNs;
+        double totalSeconds = 0.0;
+
+        while (totalSeconds < minSeconds || batchNs.size() < 20)
+        {
+            const double seconds = timeBatch(batchSize);
+            batchNs.push_back(seconds * 1.0e9 / batchSize);
+            totalSeconds += seconds;
+        }
+
+        std::sort(batchNs.begin(), batchNs.end());
+        auto percentile = [&batchNs](double p) { return batchNs[juce::jmin(batchNs.size() - 1, (size_t)(p * (batchNs.size() - 1) + 0.5))]; };
+
+        Result result;
+        result.name = name;
+        result.parameters = parameters;
+        result.operations = (juce::int64)batchNs.size() * batchSize;
+        result.nsPerOp = totalSeconds * 1.0e9 / (double)result.operations;
+        result.p50 = percentile(0.5);
+        result.p99 = percentile(0.99);
+        result.itemsPerSecond = itemsPerOp * 1.0e9 / result.nsPerOp;
+        result.unit = unit;
+        return result;
+    }
+
+    // Background thread standing in for the other side of the ring (the analysis worker or the audio thread)
+    class ContentionThread
+    {
+    public:
+        template <typename Operation>
+        explicit ContentionThread(Operation&& op)
+            : thread([this, op]() mutable { while (! shouldStop.load(std::memory_order_relaxed)) op(); })
+        {
+        }
+
+        ~ContentionThread()
+        {
+            shouldStop = true;
+            thread.join();
+        }
+
+    private:
+        std::atomic<bool> shouldStop { false };
+        std::thread thread;
+    };
+
+    std::vector<float> makeSignal(int numSamples)
+    {
+        std::vector<float> signal((size_t)numSamples);
+        juce::Random random(1234);
+        for (int i = 0; i < numSamples; ++i)
+            signal[(size_t)i] = 0.5f * std::sin(0.01f * (float)i) + 0.1f * (random.nextFloat() - 0.5f);
+        return signal;
+    }
+
+    struct Runner
+    {
+        juce::String filter;
+        double secondsPerCase = 0.2;
+        std::vector<Result> results;
+
+        bool isSelected(const juce::String& name) const { return filter.isEmpty() || name.contains(filter); }
+
+        void add(Result result)
+        {
+            std::cerr << result.name << " " << result.parameters << ": " << juce::String(result.nsPerOp, 1) << " ns/op" << std::endl;
+            results.push_back(std::move(result));
+        }
+    };
+
+    const int blockSizes[] = { 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    const int channelCounts[] = { 1, 2, 8 };
+
+    // CircularBuffer::push: one audio block into every channel, optionally while a reader takes snapshots
+    void benchmarkPush(Runner& runner)
+    {
+        if (! runner.isSelected("ring_push"))
+            return;
+
+        const std::vector<float> signal = makeSignal(4096);
+
+        for (bool contended : { false, true })
+        {
+            for (int numChannels : channelCounts)
+            {
+                for (int blockSize : blockSizes)
+                {
+                    CircularBuffer ring(numChannels, captureCapacity);
+                    std::unique_ptr<ContentionThread> reader;
+
+                    if (contended)
+                    {
+                        reader = std::make_unique<ContentionThread>([&ring]
+                        {
+                            const CircularBuffer::Snapshot snapshot = ring.getSnapshot(20000, 0);
+                            volatile float sink = snapshot.size() > 0 ? snapshot[snapshot.size() - 1] : 0.0f;
+                            juce::ignoreUnused(sink, ring.isValid(snapshot));
+                        });
+                    }
+
+                    const juce::String parameters = "block=" + juce::String(blockSize) + " channels=" + juce::String(numChannels)
+                                                    + " contention=" + (contended ? "reader" : "none");
+
+                    runner.add(measure("ring_push", parameters, (double)blockSize * numChannels, "samples/s", runner.secondsPerCase, [&]
+                    {
+                        for (int channel = 0; channel < numChannels; ++channel)
+                            ring.push(signal.data(), blockSize, channel);
+                    }));
+                }
+            }
+        }
+    }
+
+    // CircularBuffer::read: copy out the latest block of one channel, optionally while the writer pushes
+    void benchmarkRead(Runner& runner)
+    {
+        if (! runner.isSelected("ring_read"))
+            return;
+
+        const std::vector<float> signal = makeSignal(captureCapacity);
+
+        for (bool contended : { false, true })
+        {
+            for (int blockSize : blockSizes)
+            {
+                CircularBuffer ring(1, captureCapacity);
+                ring.push(signal.data(), captureCapacity, 0);
+                std::unique_ptr<ContentionThread> writer;
+
+                if (contended)
+                    writer = std::make_unique<ContentionThread>([&ring, &signal] { ring.push(signal.data(), 256, 0); });
+
+                std::vector<float> destination((size_t)blockSize);
+                const juce::String parameters = "block=" + juce::String(blockSize) + " contention=" + (contended ? "writer" : "none");
+
+                runner.add(measure("ring_read", parameters, (double)blockSize, "samples/s", runner.secondsPerCase, [&]
+                {
+                    ring.read(destination, blockSize, 0);
+                }));
+            }
+        }
+    }
+
+    // Bare transform plus magnitudes, the floor under every spectrum update
+    void benchmarkFFT(Runner& runner)
+    {
+        if (! runner.isSelected("fft"))
+            return;
+
+        for (int order = 10; order <= 19; ++order)
+        {
+            const int size = 1 << order;
+            const std::vector<float> signal = makeSignal(size);
+            std::vector<float> magnitudes((size_t)size / 2);
+            FFTEngine fftEngine;
+
+            runner.add(measure("fft", "size=" + juce::String(size), (double)size, "samples/s", runner.secondsPerCase, [&]
+            {
+                juce::FloatVectorOperations::copy(fftEngine.getInputBuffer(order), signal.data(), size);
+                fftEngine.computeMagnitudes(order, magnitudes.data());
+            }));
+        }
+    }
+
+    // Analysis plus geometry for the spectrum view: every call sees one new hop of audio, as in steady state
+    void benchmarkSpectrum(Runner& runner)
+    {
+        if (! runner.isSelected("spectrum_path"))
+            return;
+
+        for (int order = 10; order <= 19; ++order)
+        {
+            const int size = 1 << order;
+            const int hopSize = size / 4;
+            const int capacity = juce::jmax(captureCapacity, 2 * size);
+
+            AudioVisualizationProcessor processor(capacity, 1);
+            processor.setSampleRate(48000);
+            const std::vector<float> signal = makeSignal(capacity);
+            processor.pushAudioData(signal.data(), capacity, 0);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize; // Waveform reduced to a single cheap column
+            settings.waveformColumns = 1;
+            settings.stftFrameOrder = order;
+            settings.stftHopSize = hopSize;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", "fft_size=" + juce::String(size), (double)hopSize, "samples/s", runner.secondsPerCase, [&]
+            {
+                processor.pushAudioData(signal.data() + offset, hopSize, 0);
+                offset = (offset + hopSize) % (capacity - hopSize);
+                processor.analyse(settings, result);
+                arena.reset();
+                AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path);
+            }));
+        }
+
+        // Ten seconds of smoothing at 4096 points: a sliding window of frames against one in-place exponential update
+        for (SpectrumAveraging averaging : { SpectrumAveraging::linear, SpectrumAveraging::exponential })
+        {
+            const int hopSize = 1024;
+            const int capacity = 48000 * 12;
+
+            AudioVisualizationProcessor processor(capacity, 1);
+            processor.setSampleRate(48000);
+            const std::vector<float> signal = makeSignal(capacity);
+            processor.pushAudioData(signal.data(), capacity, 0);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize;
+            settings.waveformColumns = 1;
+            settings.fallbackSpeed = 10.0;
+            settings.averaging = averaging;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", juce::String("averaging=") + (averaging == SpectrumAveraging::linear ? "linear" : "exponential") + " 10s",
+                               (double)hopSize, "samples/s", runner.secondsPerCase, [&]
+            {
+                processor.pushAudioData(signal.data() + offset, hopSize, 0);
+                offset = (offset + hopSize) % (capacity - hopSize);
+                processor.analyse(settings, result);
+                arena.reset();
+                AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path);
+            }));
+        }
+
+        // The multi-rate engine covers the whole axis with 256-point transforms
+        {
+            const int hopSize = 1024;
+
+            AudioVisualizationProcessor processor(captureCapacity, 1);
+            processor.setSampleRate(48000);
+            const std::vector<float> signal = makeSignal(captureCapacity);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize;
+            settings.waveformColumns = 1;
+            settings.spectrumEngine = SpectrumEngine::constantQ;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", "engine=constant_q", (double)hopSize, "samples/s", runner.secondsPerCase, [&]
+            {
+                processor.pushAudioData(signal.data() + offset, hopSize, 0);
+                offset = (offset + hopSize) % (captureCapacity - hopSize);
+                processor.analyse(settings, result);
+                arena.reset();
+                AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path);
+            }));
+        }
+
+        // Mixing and decimating every sample dominates the zoom engine, not its 4096-point transforms
+        {
+            const int hopSize = 1024;
+
+            AudioVisualizationProcessor processor(captureCapacity, 1);
+            processor.setSampleRate(48000);
+            const std::vector<float> signal = makeSignal(captureCapacity);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize;
+            settings.waveformColumns = 1;
+            settings.spectrumEngine = SpectrumEngine::zoom;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", "engine=zoom span=200", (double)hopSize, "samples/s", runner.secondsPerCase, [&]
+            {
+                processor.pushAudioData(signal.data() + offset, hopSize, 0);
+                offset = (offset + hopSize) % (captureCapacity - hopSize);
+                processor.analyse(settings, result);
+                arena.reset();
+                AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path);
+            }));
+        }
+
+        // A 7.1.4 overlay: twelve 4096-point spectra per pass, one after another and spread over the analysis pool
+        for (bool isParallel : { false, true })
+        {
+            const int numChannels = 12;
+            const int hopSize = 1024;
+
+            juce::SharedResourcePointer<AnalysisScheduler> scheduler;
+            AudioVisualizationProcessor processor(captureCapacity, numChannels);
+            processor.setSampleRate(48000);
+            processor.setParallelScheduler(isParallel ? scheduler.get() : nullptr);
+            const std::vector<float> signal = makeSignal(captureCapacity);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize;
+            settings.waveformColumns = 1;
+            settings.overlayChannels = true;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", juce::String("channels=12 ") + (isParallel ? "parallel" : "serial"),
+                               (double)hopSize * numChannels, "samples/s", runner.secondsPerCase, [&]
+            {
+                for (int channel = 0; channel < numChannels; ++channel)
+                    processor.pushAudioData(signal.data() + offset, hopSize, channel);
+
+                offset = (offset + hopSize) % (captureCapacity - hopSize);
+                processor.analyse(settings, result);
+
+                for (int row = 0; row < result.numSpectrumChannels; ++row)
+                {
+                    arena.reset();
+                    AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path, row);
+                }
+            }));
+        }
+
+        // A stereo pair: left and right from two real transforms, against left, right, mid and side from one packed complex one
+        for (bool isMidSide : { false, true })
+        {
+            const int hopSize = 1024;
+
+            AudioVisualizationProcessor processor(captureCapacity, 2);
+            processor.setSampleRate(48000);
+            const std::vector<float> signal = makeSignal(captureCapacity);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize;
+            settings.waveformColumns = 1;
+            settings.overlayChannels = ! isMidSide;
+            settings.stereoMidSide = isMidSide;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", juce::String("stereo ") + (isMidSide ? "lrms packed" : "lr overlay"),
+                               (double)hopSize * 2, "samples/s", runner.secondsPerCase, [&]
+            {
+                processor.pushAudioData(signal.data() + offset, hopSize, 0);
+                processor.pushAudioData(signal.data() + (captureCapacity - hopSize - offset), hopSize, 1);
+
+                offset = (offset + hopSize) % (captureCapacity - hopSize);
+                processor.analyse(settings, result);
+
+                for (int row = 0; row < result.numSpectrumChannels; ++row)
+                {
+                    arena.reset();
+                    AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path, row);
+                }
+            }));
+        }
+
+        // One channel alone, against the same channel compared with a sidechain reference in one packed transform
+        for (bool isReference : { false, true })
+        {
+            const int hopSize = 1024;
+
+            AudioVisualizationProcessor processor(captureCapacity, 1, 1);
+            processor.setSampleRate(48000);
+            const std::vector<float> signal = makeSignal(captureCapacity);
+
+            AnalysisSettings settings;
+            settings.waveformSamples = WaveformPyramid::baseBlockSize;
+            settings.waveformColumns = 1;
+            settings.compareReference = isReference;
+            settings.peakHoldMode = 0;
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+            int offset = 0;
+
+            runner.add(measure("spectrum_path", juce::String("sidechain ") + (isReference ? "compared" : "off"),
+                               (double)hopSize, "samples/s", runner.secondsPerCase, [&]
+            {
+                processor.pushAudioData(signal.data() + offset, hopSize, 0);
+                processor.pushReferenceData(signal.data() + (captureCapacity - hopSize - offset), hopSize, 0);
+
+                offset = (offset + hopSize) % (captureCapacity - hopSize);
+                processor.analyse(settings, result);
+
+                for (int row = 0; row < result.numSpectrumChannels; ++row)
+                {
+                    arena.reset();
+                    AudioVisualizationProcessor::buildSpectrumPath(result, 250, 200, arena, path, row);
+                }
+            }));
+        }
+    }
+
+    // Pyramid read plus geometry for the waveform view
+    void benchmarkWaveform(Runner& runner)
+    {
+        if (! runner.isSelected("waveform_path"))
+            return;
+
+        AudioVisualizationProcessor processor(captureCapacity, 1);
+        processor.setSampleRate(48000);
+        const std::vector<float> signal = makeSignal(captureCapacity);
+        processor.pushAudioData(signal.data(), captureCapacity, 0);
+
+        for (int numSamples : { 2000, 20000, 80000 })
+        {
+            AnalysisSettings settings;
+            settings.waveformSamples = juce::jmin(numSamples, captureCapacity);
+            settings.waveformColumns = 800;
+            settings.peakHoldMode = -1; // Spectrum off
+
+            AnalysisResult result;
+            FrameArena arena;
+            juce::Path path;
+
+            runner.add(measure("waveform_path", "samples=" + juce::String(numSamples) + " columns=800", 800.0, "columns/s", runner.secondsPerCase, [&]
+            {
+                processor.analyse(settings, result);
+                arena.reset();
+                AudioVisualizationProcessor::buildVisualizationPath(result, 150, 800, arena, path);
+            }));
+        }
+    }
+
+    juce::String toTable(const std::vector<Result>& results)
+    {
+        juce::String text;
+        text << juce::String("benchmark").paddedRight(' ', 16) << juce::String("parameters").paddedRight(' ', 44)
+             << juce::String("ns/op").paddedLeft(' ', 14) << juce::String("p50").paddedLeft(' ', 14) << juce::String("p99").paddedLeft(' ', 14)
+             << "  throughput\n";
+
+        for (const auto& result : results)
+        {
+            text << result.name.paddedRight(' ', 16) << result.parameters.paddedRight(' ', 44)
+                 << juce::String(result.nsPerOp, 1).paddedLeft(' ', 14) << juce::String(result.p50, 1).paddedLeft(' ', 14)
+                 << juce::String(result.p99, 1).paddedLeft(' ', 14) << "  " << juce::String(result.itemsPerSecond, 0) << " " << result.unit << "\n";
+        }
+
+        return text;
+    }
+
+    juce::String toCsv(const std::vector<Result>& results)
+    {
+        juce::String text = "benchmark,parameters,operations,ns_per_op,p50_ns,p99_ns,throughput,unit\n";
+
+        for (const auto& result : results)
+        {
+            text << result.name << "," << result.parameters << "," << result.operations << ","
+                 << juce::String(result.nsPerOp, 3) << "," << juce::String(result.p50, 3) << "," << juce::String(result.p99, 3) << ","
+                 << juce::String(result.itemsPerSecond, 0) << "," << result.unit << "\n";
+        }
+
+        return text;
+    }
+
+    juce::String toJson(const std::vector<Result>& results)
+    {
+        auto* machine = new juce::DynamicObject();
+        machine->setProperty("cpu", juce::SystemStats::getCpuModel());
+        machine->setProperty("cpus", juce::SystemStats::getNumCpus());
+        machine->setProperty("os", juce::SystemStats::getOperatingSystemName());
+        machine->setProperty("kernels", juce::String(SpectrumKernels::getImplementationName()));
+        machine->setProperty("fftBackend", SPECTRUM_FFT_BACKEND == SPECTRUM_FFT_BACKEND_JUCE ? "juce" : "bundled");
+
+        juce::Array<juce::var> entries;
+        for (const auto& result : results)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("benchmark", result.name);
+            entry->setProperty("parameters", result.parameters);
+            entry->setProperty("operations", result.operations);
+            entry->setProperty("nsPerOp", result.nsPerOp);
+            entry->setProperty("p50Ns", result.p50);
+            entry->setProperty("p99Ns", result.p99);
+            entry->setProperty("throughput", result.itemsPerSecond);
+            entry->setProperty("unit", result.unit);
+            entries.add(juce::var(entry));
+        }
+
+        auto* root = new juce::DynamicObject();
+        root->setProperty("machine", juce::var(machine));
+        root->setProperty("results", entries);
+        return juce::JSON::toString(juce::var(root)) + "\n";
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h"))
+    {
+        std::cout << "Usage: Benchmarks [--format=table|csv|json] [--filter=<name>] [--time=<seconds per case>] [--output=<file>]\n"
+                     "       Benchmarks --test\n"
+                     "Benchmarks: ring_push, ring_read, fft, spectrum_path, waveform_path\n"
+                     "--test runs the real-time checks instead and fails if any of them does\n";
+        return 0;
+    }
+
+    if (args.containsOption("--test"))
+    {
+        juce::UnitTestRunner tests;
+        tests.setAssertOnFailure(false);
+        tests.runTestsInCategory("Realtime");
+
+        int failures = 0;
+        for (int i = 0; i < tests.getNumResults(); ++i)
+            failures += tests.getResult(i)->failures;
+
+        return failures > 0 ? 1 : 0;
+    }
+
+    Runner runner;
+    runner.filter = args.getValueForOption("--filter");
+    if (args.containsOption("--time"))
+        runner.secondsPerCase = juce::jmax(0.001, args.getValueForOption("--time").getDoubleValue());
+
+    benchmarkPush(runner);
+    benchmarkRead(runner);
+    benchmarkFFT(runner);
+    benchmarkSpectrum(runner);
+    benchmarkWaveform(runner);
+
+    const juce::String format = args.containsOption("--format") ? args.getValueForOption("--format") : juce::String("table");
+    const juce::String report = format == "json" ? toJson(runner.results)
+                              : format == "csv" ? toCsv(runner.results)
+                              : toTable(runner.results);
+
+    if (args.containsOption("--output"))
+        return args.getFileForOption("--output").replaceWithText(report) ? 0 : 1;
+
+    std::cout << report;
+    return 0;
+}
@@ -0,0 +1,322 @@
+/*
+  ==============================================================================
+
+    Offline spectrum analysis: runs the plugin's STFT analysis over audio files
+    without a host, for batch jobs and CI.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <iostream>
+#include <vector>
+#include "CircularBuffer.h"
+#include "FFTEngine.h"
+#include "StftAnalyzer.h"
+#include "SpectrumKernels.h"
+
+namespace
+{
+    struct Options
+    {
+        bool peakHold = false;        // Per-bin maximum over the file instead of the Welch average
+        int frameOrder = 12;          // Same defaults as the plugin's AnalysisSettings
+        int hopSize = 1024;
+        WindowType window = WindowType::hann;
+        int chunkSize = 1 << 16;      // Samples read from the file at a time
+        int numThreads = 1;
+        juce::File outputDirectory;   // Empty: write next to each input
+    };
+
+    // Totals over all jobs, updated as files finish
+    struct Totals
+    {
+        std::atomic<juce::int64> samples { 0 };
+        std::atomic<int> filesDone { 0 };
+        std::atomic<int> filesFailed { 0 };
+    };
+
+    juce::CriticalSection consoleLock;
+
+    void printLine(const juce::String& line)
+    {
+        const juce::ScopedLock lock(consoleLock);
+        std::cout << line << std::endl;
+    }
+
+    /**
+     * FileAnalysisJob: streams one file in chunks through the same capture ring and StftAnalyzer
+     * the plugin uses, accumulates every frame's spectrum and writes the result as CSV.
+     */
+    class FileAnalysisJob : public juce::ThreadPoolJob
+    {
+    public:
+        FileAnalysisJob(const juce::File& _input, const Options& _options, Totals& _totals)
+            : juce::ThreadPoolJob(_input.getFileName()), input(_input), options(_options), totals(_totals)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            const juce::int64 start = juce::Time::getHighResolutionTicks();
+            juce::String error;
+            double sampleRate = 0.0;
+            const juce::int64 numSamples = analyse(sampleRate, error);
+            const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+            if (numSamples < 0)
+            {
+                ++totals.filesFailed;
+                printLine(input.getFullPathName() + ": " + error);
+                return jobHasFinished;
+            }
+
+            totals.samples += numSamples;
+            ++totals.filesDone;
+
+            const double samplesPerSecond = numSamples / juce::jmax(seconds, 1.0e-9);
+            printLine(input.getFileName() + ": " + juce::String(numSamples) + " samples in " + juce::String(seconds, 3) + " s, "
+                      + juce::String(samplesPerSecond, 0) + " samples/s (" + juce::String(samplesPerSecond / sampleRate, 1) + "x real time)");
+            return jobHasFinished;
+        }
+
+    private:
+        // Returns the number of samples per channel analysed, or -1 with the reason in error
+        juce::int64 analyse(double& sampleRate, juce::String& error)
+        {
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+
+            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(input));
+            if (reader == nullptr)
+            {
+                error = "unsupported or unreadable file";
+                return -1;
+            }
+
+            const int frameSize = 1 << options.frameOrder;
+            const int numChannels = juce::jmax(1, (int)reader->numChannels);
+            const juce::int64 length = reader->lengthInSamples;
+            sampleRate = reader->sampleRate;
+
+            if (length < frameSize)
+            {
+                error = "shorter than one analysis frame";
+                return -1;
+            }
+
+            // The ring only ever needs to hold the frame being transformed plus one hop
+            CircularBuffer ring(1, frameSize + options.hopSize);
+            FFTEngine fftEngine;
+            StftAnalyzer stft;
+
+            StftAnalyzer::Config config;
+            config.frameOrder = options.frameOrder;
+            config.hopSize = options.hopSize;
+            config.window = options.window;
+            config.numFramesAveraged = 1; // Frames are combined here, over the whole file
+            stft.configure(config);
+
+            const int numBins = stft.getNumBins();
+            std::vector<float> magnitudes(numBins);
+            std::vector<double> accumulated(numBins, 0.0);
+            juce::int64 numFrames = 0;
+
+            juce::AudioBuffer<float> chunk(numChannels, options.chunkSize);
+            juce::int64 written = 0;
+            juce::int64 nextFrameEnd = frameSize;
+
+            for (juce::int64 position = 0; position < length; position += options.chunkSize)
+            {
+                const int count = (int)juce::jmin((juce::int64)options.chunkSize, length - position);
+                reader->read(&chunk, 0, count, position, true, true);
+
+                // Files are analysed as the sum of their channels, summed into the first
+                float* mono = chunk.getWritePointer(0);
+                for (int channel = 1; channel < numChannels; ++channel)
+                    juce::FloatVectorOperations::add(mono, chunk.getReadPointer(channel), count);
+
+                for (int offset = 0; offset < count;)
+                {
+                    // Push up to the end of the next frame so the analyzer sees every frame exactly once
+                    const int slice = (int)juce::jmin((juce::int64)(count - offset), nextFrameEnd - written);
+                    ring.push(mono + offset, slice, 0);
+                    offset += slice;
+                    written += slice;
+
+                    if (written < nextFrameEnd)
+                        continue;
+
+                    nextFrameEnd += options.hopSize;
+
+                    if (stft.process(ring, fftEngine) == 0)
+                        continue;
+
+                    stft.getMagnitudes(magnitudes.data());
+                    ++numFrames;
+
+                    if (options.peakHold)
+                    {
+                        for (int i = 0; i < numBins; ++i)
+                            accumulated[i] = juce::jmax(accumulated[i], (double)magnitudes[i]);
+                    }
+                    else
+                    {
+                        for (int i = 0; i < numBins; ++i)
+                            accumulated[i] += (double)magnitudes[i] * magnitudes[i];
+                    }
+                }
+            }
+
+            // Back to amplitude, then dB relative to a full-scale sine like the plugin display
+            const double frameScale = numFrames > 0 ? 1.0 / (double)numFrames : 0.0;
+            for (int i = 0; i < numBins; ++i)
+            {
+                const double magnitude = options.peakHold ? accumulated[i] : std::sqrt(accumulated[i] * frameScale);
+                magnitudes[i] = (float)(magnitude * 2.0 / frameSize);
+            }
+
+            SpectrumKernels::amplitudeToDecibels(magnitudes.data(), magnitudes.data(), numBins, -200.0f);
+
+            if (! writeCsv(magnitudes, sampleRate, frameSize))
+            {
+                error = "could not write " + getOutputFile().getFullPathName();
+                return -1;
+            }
+
+            return length;
+        }
+
+        juce::File getOutputFile() const
+        {
+            const juce::File folder = options.outputDirectory == juce::File() ? input.getParentDirectory() : options.outputDirectory;
+            return folder.getChildFile(input.getFileNameWithoutExtension() + ".spectrum.csv");
+        }
+
+        bool writeCsv(const std::vector<float>& decibels, double sampleRate, int frameSize) const
+        {
+            juce::MemoryOutputStream csv;
+            csv << "frequency_hz," << (options.peakHold ? "peak_dbfs" : "average_dbfs") << "\n";
+
+            for (size_t bin = 0; bin < decibels.size(); ++bin)
+                csv << juce::String(bin * sampleRate / frameSize, 2) << "," << juce::String(decibels[bin], 2) << "\n";
+
+            return getOutputFile().replaceWithData(csv.getData(), csv.getDataSize());
+        }
+
+        juce::File input;
+        const Options& options;
+        Totals& totals;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FileAnalysisJob)
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: OfflineAnalyzer [options] <file or folder>...\n"
+                     "  --mode=average|peak       Welch average over the file (default) or per-bin peak hold\n"
+                     "  --order=12                Frame size is 2^order samples\n"
+                     "  --hop=1024                Samples between frames\n"
+                     "  --window=hann|blackmanharris|flattop\n"
+                     "  --threads=N               Files analysed in parallel (default: number of CPUs)\n"
+                     "  --output=<folder>         Where the .spectrum.csv files go (default: next to each input)\n";
+    }
+
+    bool parseOptions(const juce::ArgumentList& args, Options& options, juce::Array<juce::File>& inputs)
+    {
+        options.numThreads = juce::SystemStats::getNumCpus();
+
+        if (args.containsOption("--mode"))
+        {
+            const juce::String mode = args.getValueForOption("--mode");
+            if (mode != "average" && mode != "peak")
+                return false;
+
+            options.peakHold = mode == "peak";
+        }
+
+        if (args.containsOption("--order"))
+            options.frameOrder = juce::jlimit((int)FFTEngine::minOrder, (int)FFTEngine::maxOrder, args.getValueForOption("--order").getIntValue());
+
+        if (args.containsOption("--hop"))
+            options.hopSize = juce::jmax(1, args.getValueForOption("--hop").getIntValue());
+
+        if (args.containsOption("--window"))
+        {
+            const juce::String window = args.getValueForOption("--window").toLowerCase();
+            if (window == "hann")                options.window = WindowType::hann;
+            else if (window == "blackmanharris") options.window = WindowType::blackmanHarris;
+            else if (window == "flattop")        options.window = WindowType::flatTop;
+            else return false;
+        }
+
+        if (args.containsOption("--threads"))
+            options.numThreads = juce::jmax(1, args.getValueForOption("--threads").getIntValue());
+
+        if (args.containsOption("--output"))
+        {
+            options.outputDirectory = args.getFileForOption("--output");
+            if (! options.outputDirectory.createDirectory())
+                return false;
+        }
+
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        const juce::String wildcard = formatManager.getWildcardForAllFormats();
+
+        for (const auto& argument : args.arguments)
+        {
+            if (argument.isOption())
+                continue;
+
+            const juce::File file = argument.resolveAsFile();
+            if (file.isDirectory())
+                inputs.addArray(file.findChildFiles(juce::File::findFiles, true, wildcard));
+            else if (file.existsAsFile())
+                inputs.add(file);
+            else
+                std::cerr << "Skipping missing input " << file.getFullPathName() << std::endl;
+        }
+
+        return ! inputs.isEmpty();
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    const juce::ArgumentList args(argc, argv);
+
+    Options options;
+    juce::Array<juce::File> inputs;
+
+    if (args.containsOption("--help|-h") || ! parseOptions(args, options, inputs))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Totals totals;
+    const juce::int64 start = juce::Time::getHighResolutionTicks();
+
+    {
+        // Files are independent, so they simply fan out over the pool
+        juce::ThreadPool pool(juce::jmin(options.numThreads, inputs.size()));
+
+        for (const auto& input : inputs)
+            pool.addJob(new FileAnalysisJob(input, options, totals), true);
+
+        while (pool.getNumJobs() > 0)
+            juce::Thread::sleep(20);
+    }
+
+    const double seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+    const juce::int64 samples = totals.samples.load();
+
+    printLine("Analysed " + juce::String(totals.filesDone.load()) + " file(s), " + juce::String(totals.filesFailed.load()) + " failed: "
+              + juce::String(samples) + " samples in " + juce::String(seconds, 3) + " s, "
+              + juce::String(samples / juce::jmax(seconds, 1.0e-9), 0) + " samples/s");
+
+    return totals.filesFailed.load() == 0 ? 0 : 2;
+}